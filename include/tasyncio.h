@@ -0,0 +1,497 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Асинхронные чтение и запись двоичных файлов матриц (io_uring или пул потоков)
+
+#ifndef __TAsyncIO_H__
+#define __TAsyncIO_H__
+
+#include "tmatrixio.h"
+
+#include <atomic>
+#include <climits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#if defined(__linux__) && !defined(TMATRIX_NO_IO_URING) && __has_include(<linux/io_uring.h>)
+#define TMATRIX_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+// Наибольшее число буферов в одном запросе: readv/writev с большим числом
+// ядро отвергает
+#if defined(IOV_MAX)
+#define TMATRIX_IOV_MAX IOV_MAX
+#else
+#define TMATRIX_IOV_MAX 1024
+#endif
+
+// Участок памяти для ввода/вывода
+struct TIoBuffer {
+    void* data;
+    size_t size;
+};
+
+// Запрос: непрерывный участок файла с offset, разложенный по буферам
+struct TIoRequest {
+    uint64_t offset;
+    std::vector<TIoBuffer> buffers;
+};
+
+// Способ выполнения запросов
+enum class TIoBackend { Auto, IoUring, Threads };
+
+struct TAsyncOptions {
+    size_t queueDepth = 8;               // Запросов в обработке одновременно
+    size_t chunkBytes = size_t(4) << 20; // Примерный объем одного запроса
+    TIoBackend backend = TIoBackend::Auto;
+};
+
+#if defined(TMATRIX_IO_URING)
+// Минимальная обертка над системными вызовами io_uring (без liburing)
+class TIoUring {
+    int fd = -1;
+    void* sqPtr = nullptr;
+    void* cqPtr = nullptr;
+    size_t sqLen = 0, cqLen = 0, sqesLen = 0;
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned* sqMask;
+    unsigned* sqArray;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned* cqMask;
+    io_uring_sqe* sqes = nullptr;
+    io_uring_cqe* cqes;
+    unsigned pendingSubmit = 0;
+
+    void unmap() noexcept {
+        if (sqes != nullptr)
+            munmap(sqes, sqesLen);
+        if (cqPtr != nullptr)
+            munmap(cqPtr, cqLen);
+        if (sqPtr != nullptr)
+            munmap(sqPtr, sqLen);
+        if (fd >= 0)
+            close(fd);
+        sqes = nullptr;
+        cqPtr = sqPtr = nullptr;
+        fd = -1;
+    }
+
+public:
+    // entries - размер очереди; при неудаче (ядро без io_uring, запрет
+    // seccomp) объект остается неготовым, см. ready()
+    explicit TIoUring(unsigned entries) {
+        io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        fd = int(syscall(__NR_io_uring_setup, entries, &p));
+        if (fd < 0)
+            return;
+        sqLen = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cqLen = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        sqesLen = p.sq_entries * sizeof(io_uring_sqe);
+        sqPtr = mmap(nullptr, sqLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        cqPtr = mmap(nullptr, cqLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        void* s = mmap(nullptr, sqesLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqPtr == MAP_FAILED) sqPtr = nullptr;
+        if (cqPtr == MAP_FAILED) cqPtr = nullptr;
+        sqes = s == MAP_FAILED ? nullptr : static_cast<io_uring_sqe*>(s);
+        if (sqPtr == nullptr || cqPtr == nullptr || sqes == nullptr) {
+            unmap();
+            return;
+        }
+        char* sq = static_cast<char*>(sqPtr);
+        char* cq = static_cast<char*>(cqPtr);
+        sqHead = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+        sqTail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        cqHead = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+    }
+
+    TIoUring(const TIoUring&) = delete;
+    TIoUring& operator=(const TIoUring&) = delete;
+
+    ~TIoUring() {
+        unmap();
+    }
+
+    bool ready() const noexcept { return fd >= 0; }
+
+    // Поставить в очередь readv/writev; отправляется в enter()
+    bool push(bool write, int file, const iovec* iov, unsigned count, uint64_t offset, uint64_t tag) {
+        unsigned tail = *sqTail;
+        if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) > *sqMask)
+            return false;
+        unsigned idx = tail & *sqMask;
+        io_uring_sqe& e = sqes[idx];
+        std::memset(&e, 0, sizeof(e));
+        e.opcode = write ? IORING_OP_WRITEV : IORING_OP_READV;
+        e.fd = file;
+        e.addr = reinterpret_cast<uint64_t>(iov);
+        e.len = count;
+        e.off = offset;
+        e.user_data = tag;
+        sqArray[idx] = idx;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        pendingSubmit++;
+        return true;
+    }
+
+    // Отправить поставленное и дождаться хотя бы minComplete завершений
+    void enter(unsigned minComplete) {
+        for (;;) {
+            long r = syscall(__NR_io_uring_enter, fd, pendingSubmit, minComplete,
+                             minComplete ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (r >= 0) {
+                pendingSubmit -= unsigned(r);
+                return;
+            }
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                throw std::runtime_error("io_uring_enter failed");
+        }
+    }
+
+    // Забрать одно завершение: tag и результат (байты или -errno)
+    bool pop(uint64_t& tag, int& res) {
+        unsigned head = *cqHead;
+        if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE))
+            return false;
+        const io_uring_cqe& c = cqes[head & *cqMask];
+        tag = c.user_data;
+        res = c.res;
+        __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+};
+#endif
+
+// Выполнение набора запросов к файлу в фоне.
+// С io_uring один фоновый поток держит в очереди до queueDepth запросов и
+// разбирает завершения; без него (другая ОС, ядро без io_uring, запрет
+// системного вызова) queueDepth потоков выполняют запросы синхронным
+// чтением/записью по смещению. onDone(i) вызывается из фонового потока по
+// завершении запроса i, onEnd() - когда фоновая работа окончена (в том
+// числе с ошибкой). Частичные чтения и записи дозапрашиваются.
+class TAsyncIO {
+    TFile& file;
+    bool write;
+    std::vector<TIoRequest> reqs;
+    std::function<void(size_t)> onDone;
+    std::function<void()> onEnd;
+    std::vector<std::thread> threads;
+#if defined(TMATRIX_IO_URING)
+    std::unique_ptr<TIoUring> ring;
+#endif
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    bool uring = false;
+
+    void fail(std::exception_ptr e) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!error)
+            error = e;
+    }
+
+    // Пропустить done байт запроса: уменьшить буферы с начала
+    static void advance(std::vector<TIoBuffer>& bufs, uint64_t& offset, size_t done) {
+        offset += done;
+        size_t k = 0;
+        while (k < bufs.size() && done >= bufs[k].size)
+            done -= bufs[k++].size;
+        bufs.erase(bufs.begin(), bufs.begin() + k);
+        if (!bufs.empty()) {
+            bufs[0].data = static_cast<char*>(bufs[0].data) + done;
+            bufs[0].size -= done;
+        }
+    }
+
+    void runSync(size_t workers) {
+        std::atomic<size_t> next(0);
+        auto work = [this, &next] {
+            for (size_t i = next++; i < reqs.size(); i = next++) {
+                try {
+                    uint64_t offset = reqs[i].offset;
+                    for (const TIoBuffer& b : reqs[i].buffers) {
+                        if (write)
+                            file.writeAt(offset, b.data, b.size);
+                        else
+                            file.readAt(offset, b.data, b.size);
+                        offset += b.size;
+                    }
+                    onDone(i);
+                } catch (...) {
+                    fail(std::current_exception());
+                    return;
+                }
+            }
+        };
+        std::vector<std::thread> pool;
+        for (size_t w = 1; w < workers; w++)
+            pool.emplace_back(work);
+        work();
+        for (auto& t : pool)
+            t.join();
+    }
+
+#if defined(TMATRIX_IO_URING)
+    void runUring(TIoUring& ring, size_t depth) {
+        std::vector<std::vector<iovec>> iovs(reqs.size());
+        std::vector<uint64_t> offsets(reqs.size());
+        size_t next = 0, inFlight = 0, done = 0;
+        auto submit = [&](size_t i) {
+            iovs[i].resize(reqs[i].buffers.size());
+            for (size_t k = 0; k < iovs[i].size(); k++)
+                iovs[i][k] = iovec{ reqs[i].buffers[k].data, reqs[i].buffers[k].size };
+            if (!ring.push(write, file.handle(), iovs[i].data(), unsigned(iovs[i].size()), offsets[i], i))
+                throw std::runtime_error("io_uring submission queue is full");
+            inFlight++;
+        };
+        try {
+            while (done < reqs.size()) {
+                while (next < reqs.size() && inFlight < depth) {
+                    offsets[next] = reqs[next].offset;
+                    submit(next++);
+                }
+                ring.enter(1);
+                uint64_t tag;
+                int res;
+                while (ring.pop(tag, res)) {
+                    inFlight--;
+                    size_t i = size_t(tag);
+                    if (res < 0 && (res == -EINTR || res == -EAGAIN)) {
+                        submit(i);
+                        continue;
+                    }
+                    if (res <= 0)
+                        throw std::runtime_error(write ? "File write failed" : "File read failed");
+                    advance(reqs[i].buffers, offsets[i], size_t(res));
+                    if (!reqs[i].buffers.empty()) {
+                        submit(i);
+                        continue;
+                    }
+                    done++;
+                    onDone(i);
+                }
+            }
+        } catch (...) {
+            fail(std::current_exception());
+            // Запросы в ядре еще ссылаются на iovs: дождаться их
+            while (inFlight > 0) {
+                try {
+                    ring.enter(1);
+                } catch (...) {
+                    break;
+                }
+                uint64_t tag;
+                int res;
+                while (ring.pop(tag, res))
+                    inFlight--;
+            }
+        }
+    }
+#endif
+
+public:
+    TAsyncIO(TFile& f, bool isWrite, std::vector<TIoRequest> requests, std::function<void(size_t)> done,
+             std::function<void()> end, const TAsyncOptions& opts = TAsyncOptions())
+        : file(f), write(isWrite), reqs(std::move(requests)), onDone(std::move(done)), onEnd(std::move(end)) {
+        const size_t depth = std::max<size_t>(1, opts.queueDepth);
+#if defined(TMATRIX_IO_URING)
+        if (opts.backend != TIoBackend::Threads) {
+            ring.reset(new TIoUring(unsigned(depth)));
+            if (ring->ready()) {
+                uring = true;
+                threads.emplace_back([this, depth] {
+                    runUring(*ring, depth);
+                    onEnd();
+                });
+                return;
+            }
+            ring.reset();
+        }
+#endif
+        if (opts.backend == TIoBackend::IoUring)
+            throw std::runtime_error("io_uring is not available");
+        threads.emplace_back([this, depth] {
+            runSync(depth);
+            onEnd();
+        });
+    }
+
+    TAsyncIO(const TAsyncIO&) = delete;
+    TAsyncIO& operator=(const TAsyncIO&) = delete;
+
+    ~TAsyncIO() {
+        for (auto& t : threads) {
+            if (t.joinable())
+                t.join();
+        }
+    }
+
+    bool usesIoUring() const noexcept { return uring; }
+
+    // Дождаться всех запросов; первая ошибка передается вызывающему
+    void wait() {
+        for (auto& t : threads) {
+            if (t.joinable())
+                t.join();
+        }
+        if (error)
+            std::rethrow_exception(error);
+    }
+};
+
+// Строк в одном запросе: объем около chunkBytes, не больше TMATRIX_IOV_MAX буферов
+inline size_t rowsPerRequest(size_t rowBytes, size_t chunkBytes) {
+    return std::min<size_t>(TMATRIX_IOV_MAX, std::max<size_t>(1, chunkBytes / rowBytes));
+}
+
+// Разбиение строк [0, n) на запросы по целым строкам, по одному буферу на строку
+template<typename T, typename RowPtr>
+std::vector<TIoRequest> rowRequests(size_t n, uint64_t dataOffset, size_t chunkBytes, RowPtr row) {
+    const size_t rowBytes = n * sizeof(T);
+    const size_t rowsPerChunk = rowsPerRequest(rowBytes, chunkBytes);
+    std::vector<TIoRequest> reqs;
+    for (size_t r = 0; r < n; r += rowsPerChunk) {
+        TIoRequest q{ dataOffset + uint64_t(r) * rowBytes, {} };
+        for (size_t i = r; i < std::min(n, r + rowsPerChunk); i++)
+            q.buffers.push_back(TIoBuffer{ const_cast<void*>(static_cast<const void*>(row(i))), rowBytes });
+        reqs.push_back(std::move(q));
+    }
+    return reqs;
+}
+
+// Асинхронная загрузка матрицы из двоичного файла (формат saveBinary).
+// Матрица создается сразу, строки заполняются по мере прихода данных;
+// rowsReady() - сколько первых строк уже загружено, waitRows(k) ждет
+// первые k строк, row(i) отдает загруженную строку без ожидания, так что
+// вычисления над ними идут параллельно с чтением. get() ждет всю матрицу.
+template<typename T>
+class TAsyncMatrixLoader {
+    TFile file;
+    TBinaryHeader header;
+    TDynamicMatrix<T> m;
+    size_t rowsPerChunk;
+    std::vector<char> chunkDone;
+    size_t prefixChunks = 0;
+    std::atomic<size_t> ready{ 0 };
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool ended = false;
+    std::unique_ptr<TAsyncIO> io;
+
+    static TBinaryHeader readHeader(const TFile& f) {
+        TBinaryHeader h;
+        if (f.size() < sizeof(h))
+            throw std::runtime_error("Binary matrix file is truncated");
+        f.readAt(0, &h, sizeof(h));
+        checkBinaryHeader<T>(h, 2, f.size());
+        return h;
+    }
+
+    void chunkFinished(size_t i) {
+        std::lock_guard<std::mutex> lock(mtx);
+        chunkDone[i] = 1;
+        while (prefixChunks < chunkDone.size() && chunkDone[prefixChunks])
+            prefixChunks++;
+        ready.store(std::min(m.size(), prefixChunks * rowsPerChunk), std::memory_order_release);
+        cv.notify_all();
+    }
+
+    void ioEnded() {
+        std::lock_guard<std::mutex> lock(mtx);
+        ended = true;
+        cv.notify_all();
+    }
+
+public:
+    explicit TAsyncMatrixLoader(const std::string& path, const TAsyncOptions& opts = TAsyncOptions())
+        : file(path, TFile::Read), header(readHeader(file)), m(size_t(header.rows)) {
+        rowsPerChunk = rowsPerRequest(m.size() * sizeof(T), opts.chunkBytes);
+        std::vector<TIoRequest> reqs = rowRequests<T>(m.size(), header.dataOffset, opts.chunkBytes,
+                                                      [this](size_t i) { return m[i].data(); });
+        chunkDone.assign(reqs.size(), 0);
+        io.reset(new TAsyncIO(file, false, std::move(reqs), [this](size_t i) { chunkFinished(i); },
+                              [this] { ioEnded(); }, opts));
+    }
+
+    ~TAsyncMatrixLoader() {
+        io.reset(); // Дождаться фоновых операций до освобождения строк
+    }
+
+    bool usesIoUring() const noexcept { return io->usesIoUring(); }
+
+    size_t size() const noexcept { return m.size(); }
+
+    // Сколько первых строк уже загружено
+    size_t rowsReady() const noexcept { return ready.load(std::memory_order_acquire); }
+
+    // Дождаться загрузки первых k строк; ошибка чтения передается вызывающему
+    void waitRows(size_t k) {
+        k = std::min(k, m.size());
+        if (rowsReady() >= k)
+            return;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [&] { return rowsReady() >= k || ended; });
+        }
+        if (rowsReady() < k) {
+            io->wait();
+            throw std::runtime_error("Binary matrix data is truncated");
+        }
+    }
+
+    // Уже загруженная строка i < rowsReady(), без ожидания остальных;
+    // готовность строк обеспечивает waitRows
+    const TDynamicVector<T>& row(size_t i) const {
+        if (i >= rowsReady())
+            throw out_of_range("Row is not loaded yet");
+        return m[i];
+    }
+
+    // Дождаться всей матрицы
+    TDynamicMatrix<T>& get() {
+        io->wait();
+        return m;
+    }
+};
+
+// Асинхронная запись матрицы в двоичный файл (формат saveBinary).
+// Матрицу нельзя изменять до завершения wait().
+template<typename T>
+class TAsyncMatrixSaver {
+    TFile file;
+    std::unique_ptr<TAsyncIO> io;
+
+public:
+    TAsyncMatrixSaver(const std::string& path, const TDynamicMatrix<T>& m, const TAsyncOptions& opts = TAsyncOptions())
+        : file(path, TFile::Create) {
+        TBinaryHeader h = makeBinaryHeader<T>(2, m.size(), m.size());
+        file.writeAt(0, &h, sizeof(h));
+        std::vector<TIoRequest> reqs = rowRequests<T>(m.size(), h.dataOffset, opts.chunkBytes,
+                                                      [&m](size_t i) { return m[i].data(); });
+        io.reset(new TAsyncIO(file, true, std::move(reqs), [](size_t) {}, [] {}, opts));
+    }
+
+    ~TAsyncMatrixSaver() {
+        io.reset();
+    }
+
+    bool usesIoUring() const noexcept { return io->usesIoUring(); }
+
+    void wait() {
+        io->wait();
+    }
+};
+
+#endif
@@ -0,0 +1,378 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Сжатый формат матриц: плитки сжимаются независимо (разности, перестановка
+// байтов, LZ-сжатие), распаковываются параллельно и по одной
+
+#ifndef __TCompressed_H__
+#define __TCompressed_H__
+
+#include "tmatrixio.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+
+// Сжатие LZ с окном 64 КБ в духе LZ4: последовательность - байт-признак
+// (длина литералов и длина совпадения по 4 бита, 15 - продолжение байтами),
+// литералы, смещение совпадения (2 байта) и продолжение длины совпадения.
+// Последняя последовательность содержит только литералы.
+namespace lz {
+
+const size_t minMatch = 4;
+const size_t hashBits = 12;
+const size_t maxOffset = 65535;
+
+inline uint32_t read32(const uint8_t* p) noexcept {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void putLength(std::vector<uint8_t>& out, size_t len) {
+    for (; len >= 255; len -= 255)
+        out.push_back(255);
+    out.push_back(uint8_t(len));
+}
+
+inline void putSequence(std::vector<uint8_t>& out, const uint8_t* lit, size_t litLen, size_t offset, size_t matchLen) {
+    size_t m = matchLen - minMatch;
+    out.push_back(uint8_t((std::min<size_t>(litLen, 15) << 4) | std::min<size_t>(m, 15)));
+    if (litLen >= 15)
+        putLength(out, litLen - 15);
+    out.insert(out.end(), lit, lit + litLen);
+    out.push_back(uint8_t(offset));
+    out.push_back(uint8_t(offset >> 8));
+    if (m >= 15)
+        putLength(out, m - 15);
+}
+
+// Сжатые данные дописываются в out
+inline void compress(const uint8_t* src, size_t n, std::vector<uint8_t>& out) {
+    std::vector<uint32_t> table(size_t(1) << hashBits, 0); // Позиция + 1, 0 - пусто
+    size_t pos = 0, anchor = 0, misses = 0;
+    while (n >= minMatch && pos <= n - minMatch) {
+        uint32_t h = (read32(src + pos) * 2654435761u) >> (32 - hashBits);
+        size_t cand = table[h];
+        table[h] = uint32_t(pos + 1);
+        if (cand != 0 && pos - (cand - 1) <= maxOffset && read32(src + cand - 1) == read32(src + pos)) {
+            size_t ref = cand - 1, len = minMatch;
+            while (pos + len < n && src[ref + len] == src[pos + len])
+                len++;
+            putSequence(out, src + anchor, pos - anchor, pos - ref, len);
+            pos += len;
+            anchor = pos;
+            misses = 0;
+        } else {
+            pos += 1 + (misses++ >> 6); // На несжимаемых данных шаг растет
+        }
+    }
+    size_t litLen = n - anchor;
+    out.push_back(uint8_t(std::min<size_t>(litLen, 15) << 4));
+    if (litLen >= 15)
+        putLength(out, litLen - 15);
+    out.insert(out.end(), src + anchor, src + n);
+}
+
+inline size_t getLength(const uint8_t*& ip, const uint8_t* end, size_t len) {
+    if (len != 15)
+        return len;
+    for (;;) {
+        if (ip == end)
+            throw std::runtime_error("Compressed data is corrupted");
+        uint8_t b = *ip++;
+        len += b;
+        if (b != 255)
+            return len;
+    }
+}
+
+// Распаковка ровно в n байтов dst
+inline void decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t n) {
+    const uint8_t* ip = src;
+    const uint8_t* end = src + srcSize;
+    size_t op = 0;
+    for (;;) {
+        if (ip == end)
+            throw std::runtime_error("Compressed data is corrupted");
+        uint8_t token = *ip++;
+        size_t litLen = getLength(ip, end, token >> 4);
+        if (litLen > size_t(end - ip) || litLen > n - op)
+            throw std::runtime_error("Compressed data is corrupted");
+        std::memcpy(dst + op, ip, litLen);
+        ip += litLen;
+        op += litLen;
+        if (ip == end)
+            break;
+        if (end - ip < 2)
+            throw std::runtime_error("Compressed data is corrupted");
+        size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+        ip += 2;
+        size_t len = getLength(ip, end, token & 15) + minMatch;
+        if (offset == 0 || offset > op || len > n - op)
+            throw std::runtime_error("Compressed data is corrupted");
+        uint8_t* d = dst + op;
+        const uint8_t* s = d - offset;
+        if (offset >= len) {
+            std::memcpy(d, s, len);
+        } else {
+            for (size_t k = 0; k < len; k++) // Совпадение перекрывает само себя
+                d[k] = s[k];
+        }
+        op += len;
+    }
+    if (op != n)
+        throw std::runtime_error("Compressed data is corrupted");
+}
+
+} // namespace lz
+
+// Фильтры плитки перед сжатием
+enum TTileFilter : uint32_t {
+    TileDelta = 1,      // Разности соседних элементов (над битовым представлением)
+    TileShuffle = 2,    // Байты с одинаковым номером в элементе собраны вместе
+    TileLZ = 4          // Сжатие LZ; без него плитка хранится как есть
+};
+
+struct TCompressOptions {
+    size_t tile = 256;      // Сторона плитки
+    bool delta = true;
+    bool shuffle = true;
+};
+
+// Элемент оглавления: где лежит плитка и как она закодирована
+struct TCompressedTile {
+    uint64_t offset;
+    uint32_t bytes;
+    uint32_t filters;
+};
+
+static_assert(sizeof(TCompressedTile) == 16, "Compressed tile entry must occupy 16 bytes");
+
+template<size_t Size> struct TDeltaWord;
+template<> struct TDeltaWord<1> { typedef uint8_t type; };
+template<> struct TDeltaWord<2> { typedef uint16_t type; };
+template<> struct TDeltaWord<4> { typedef uint32_t type; };
+template<> struct TDeltaWord<8> { typedef uint64_t type; };
+
+// Кодирование count элементов; результат дописывается в out, возвращаются фильтры
+template<typename T>
+uint32_t encodeTile(const T* p, size_t count, const TCompressOptions& opts, std::vector<uint8_t>& out) {
+    typedef typename TDeltaWord<sizeof(T)>::type U;
+    const size_t bytes = count * sizeof(T);
+    std::vector<uint8_t> a(bytes), b;
+    std::memcpy(a.data(), p, bytes);
+    uint32_t filters = TileLZ;
+    if (opts.delta) {
+        U prev = 0;
+        for (size_t i = 0; i < count; i++) {
+            U cur;
+            std::memcpy(&cur, a.data() + i * sizeof(T), sizeof(T));
+            U d = U(cur - prev);
+            std::memcpy(a.data() + i * sizeof(T), &d, sizeof(T));
+            prev = cur;
+        }
+        filters |= TileDelta;
+    }
+    if (opts.shuffle && sizeof(T) > 1) {
+        b.resize(bytes);
+        for (size_t i = 0; i < count; i++)
+            for (size_t k = 0; k < sizeof(T); k++)
+                b[k * count + i] = a[i * sizeof(T) + k];
+        a.swap(b);
+        filters |= TileShuffle;
+    }
+    const size_t start = out.size();
+    lz::compress(a.data(), bytes, out);
+    if (out.size() - start >= bytes) { // Не сжалось - хранится как есть
+        out.resize(start);
+        const uint8_t* raw = reinterpret_cast<const uint8_t*>(p);
+        out.insert(out.end(), raw, raw + bytes);
+        return 0;
+    }
+    return filters;
+}
+
+// Декодирование в count элементов; buf - рабочий буфер
+template<typename T>
+void decodeTile(const uint8_t* src, size_t srcSize, uint32_t filters, T* p, size_t count, std::vector<uint8_t>& buf) {
+    typedef typename TDeltaWord<sizeof(T)>::type U;
+    const size_t bytes = count * sizeof(T);
+    uint8_t* dst = reinterpret_cast<uint8_t*>(p);
+    if ((filters & ~uint32_t(TileDelta | TileShuffle | TileLZ)) != 0 || (filters != 0 && !(filters & TileLZ)))
+        throw std::runtime_error("Unknown compressed tile encoding");
+    if (filters == 0) {
+        if (srcSize != bytes)
+            throw std::runtime_error("Compressed data is corrupted");
+        std::memcpy(dst, src, bytes);
+        return;
+    }
+    if (filters & TileShuffle) {
+        buf.resize(bytes);
+        lz::decompress(src, srcSize, buf.data(), bytes);
+        for (size_t k = 0; k < sizeof(T); k++)
+            for (size_t i = 0; i < count; i++)
+                dst[i * sizeof(T) + k] = buf[k * count + i];
+    } else {
+        lz::decompress(src, srcSize, dst, bytes);
+    }
+    if (filters & TileDelta) {
+        U prev = 0;
+        for (size_t i = 0; i < count; i++) {
+            U d;
+            std::memcpy(&d, dst + i * sizeof(T), sizeof(T));
+            prev = U(prev + d);
+            std::memcpy(dst + i * sizeof(T), &prev, sizeof(T));
+        }
+    }
+}
+
+// Запись матрицы в сжатом формате: TBinaryHeader с layout == 2 и стороной
+// плитки в tile, с dataOffset - оглавление из TCompressedTile для плиток
+// по строкам плиток, затем сами плитки. Плитка у края матрицы хранится
+// без дополнения, элементы по строкам. Плитки сжимаются в потоках пула.
+template<typename T>
+void writeCompressed(ostream& ostr, const TDynamicMatrix<T>& m, const TCompressOptions& opts = TCompressOptions(),
+                     TThreadPool& pool = TThreadPool::global()) {
+    if (opts.tile == 0 || opts.tile > UINT32_MAX)
+        throw std::out_of_range("Tile size should be greater than zero");
+    const size_t n = m.size(), t = opts.tile, nt = (n + t - 1) / t;
+    std::vector<std::vector<uint8_t>> blobs(nt * nt);
+    std::vector<TCompressedTile> index(nt * nt);
+    pool.parallelFor(0, nt * nt, [&](size_t lo, size_t hi, size_t) {
+        std::vector<T> tile;
+        for (size_t k = lo; k < hi; k++) {
+            size_t ti = k / nt, tj = k % nt;
+            size_t r0 = ti * t, c0 = tj * t, rows = std::min(t, n - r0), cols = std::min(t, n - c0);
+            tile.resize(rows * cols);
+            for (size_t i = 0; i < rows; i++) {
+                const T* row = m[r0 + i].data() + c0;
+                std::copy(row, row + cols, tile.data() + i * cols);
+            }
+            index[k].filters = encodeTile(tile.data(), tile.size(), opts, blobs[k]);
+            if (blobs[k].size() > UINT32_MAX)
+                throw std::out_of_range("Compressed tile is too large");
+            index[k].bytes = uint32_t(blobs[k].size());
+        }
+    });
+
+    TBinaryHeader h = makeBinaryHeader<T>(2, n, n);
+    h.layout = 2;
+    h.tile = uint32_t(t);
+    uint64_t offset = h.dataOffset + index.size() * sizeof(TCompressedTile);
+    for (TCompressedTile& e : index) {
+        e.offset = offset;
+        offset += e.bytes;
+    }
+    ostr.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    ostr.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(TCompressedTile));
+    for (const std::vector<uint8_t>& b : blobs)
+        ostr.write(reinterpret_cast<const char*>(b.data()), b.size());
+    if (!ostr)
+        throw std::runtime_error("Failed to write compressed matrix");
+}
+
+template<typename T>
+void saveCompressed(const std::string& path, const TDynamicMatrix<T>& m, const TCompressOptions& opts = TCompressOptions(),
+                    TThreadPool& pool = TThreadPool::global()) {
+    std::ofstream f(path, std::ios::binary);
+    if (!f)
+        throw std::runtime_error("Cannot open file for writing: " + path);
+    writeCompressed(f, m, opts, pool);
+}
+
+// Сжатая матрица в файле: оглавление читается при открытии, плитки - по
+// запросу (readTile можно вызывать из нескольких потоков) или все сразу
+// параллельно (toMatrix).
+template<typename T>
+class TCompressedMatrix {
+    TFile file;
+    size_t n, tile, nt;
+    std::vector<TCompressedTile> index;
+
+public:
+    explicit TCompressedMatrix(const std::string& path) : file(path, TFile::Read) {
+        TBinaryHeader h;
+        const uint64_t fileSize = file.size();
+        if (fileSize < sizeof(h))
+            throw std::runtime_error("Binary matrix file is truncated");
+        file.readAt(0, &h, sizeof(h));
+        if (h.layout != 2 || h.tile == 0)
+            throw std::runtime_error("Not a compressed matrix file");
+        h.layout = 0;
+        checkBinaryHeader<T>(h, 2);
+        n = size_t(h.rows);
+        tile = h.tile;
+        nt = (n + tile - 1) / tile;
+        if (fileSize < h.dataOffset || (fileSize - h.dataOffset) / sizeof(TCompressedTile) < nt * nt)
+            throw std::runtime_error("Binary matrix file is truncated");
+        index.resize(nt * nt);
+        file.readAt(h.dataOffset, index.data(), index.size() * sizeof(TCompressedTile));
+        for (const TCompressedTile& e : index) {
+            if (e.offset > fileSize || fileSize - e.offset < e.bytes)
+                throw std::runtime_error("Binary matrix file is truncated");
+        }
+    }
+
+    size_t size() const noexcept { return n; }
+    size_t tileSize() const noexcept { return tile; }
+    size_t tileCount() const noexcept { return nt; } // Плиток по каждой стороне
+
+    // Конец диапазона строк (столбцов) плитки номер t
+    size_t rowEnd(size_t t) const noexcept { return std::min(n, (t + 1) * tile); }
+
+    // Размер сжатых плиток в файле
+    uint64_t compressedBytes() const noexcept {
+        uint64_t res = 0;
+        for (const TCompressedTile& e : index)
+            res += e.bytes;
+        return res;
+    }
+
+    // Плитка (ti, tj) в dst: (rowEnd(ti) - ti * tile) x (rowEnd(tj) - tj * tile) элементов по строкам
+    void readTile(size_t ti, size_t tj, T* dst) const {
+        std::vector<uint8_t> src, buf;
+        readTile(ti, tj, dst, src, buf);
+    }
+
+    void readTile(size_t ti, size_t tj, T* dst, std::vector<uint8_t>& src, std::vector<uint8_t>& buf) const {
+        if (ti >= nt || tj >= nt)
+            throw std::out_of_range("Tile index out of range");
+        const TCompressedTile& e = index[ti * nt + tj];
+        src.resize(e.bytes);
+        file.readAt(e.offset, src.data(), e.bytes);
+        decodeTile(src.data(), src.size(), e.filters, dst, (rowEnd(ti) - ti * tile) * (rowEnd(tj) - tj * tile), buf);
+    }
+
+    // Распаковка всей матрицы в потоках пула
+    TDynamicMatrix<T> toMatrix(TThreadPool& pool = TThreadPool::global()) const {
+        TDynamicMatrix<T> m(n, TPlacement::firstTouch(), pool);
+        std::vector<T*> rowData(n);
+        for (size_t i = 0; i < n; i++)
+            rowData[i] = m[i].data();
+        pool.parallelFor(0, nt * nt, [&](size_t lo, size_t hi, size_t) {
+            std::vector<uint8_t> src, buf;
+            std::vector<T> t(tile * tile);
+            for (size_t k = lo; k < hi; k++) {
+                size_t ti = k / nt, tj = k % nt, c0 = tj * tile, cols = rowEnd(tj) - c0;
+                readTile(ti, tj, t.data(), src, buf);
+                for (size_t i = ti * tile; i < rowEnd(ti); i++) {
+                    const T* row = t.data() + (i - ti * tile) * cols;
+                    std::copy(row, row + cols, rowData[i] + c0);
+                }
+            }
+        });
+        return m;
+    }
+};
+
+template<typename T>
+TDynamicMatrix<T> loadCompressedMatrix(const std::string& path, TThreadPool& pool = TThreadPool::global()) {
+    return TCompressedMatrix<T>(path).toMatrix(pool);
+}
+
+#endif
@@ -0,0 +1,446 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Матрицы во внешней памяти: хранение по плиткам в файле, кэш плиток LRU
+
+#ifndef __TDiskMatrix_H__
+#define __TDiskMatrix_H__
+
+#include "tmatrixio.h"
+
+#include <list>
+#include <unordered_map>
+#include <cmath>
+
+struct TTileCacheStats {
+    size_t hits = 0;        // Плитка уже была в кэше
+    size_t reads = 0;       // Плитка прочитана из файла
+    size_t writes = 0;      // Измененная плитка записана в файл
+};
+
+// Кэш плиток с вытеснением давно не использованных (LRU) и общим бюджетом
+// памяти на все матрицы, которые им пользуются. Плитка, захваченная
+// TPin, не вытесняется; если захвачено больше бюджета, кэш временно его
+// превышает. Измененные плитки записываются в файл при вытеснении и flush.
+// Кэш не потокобезопасен.
+class TTileCache {
+public:
+    // Файл с плитками одинакового размера
+    struct TStore {
+        TFile file;
+        uint64_t dataOffset;
+        size_t tileBytes;
+
+        TStore(const std::string& path, TFile::TMode mode, uint64_t offset, size_t bytes)
+            : file(path, mode), dataOffset(offset), tileBytes(bytes) {}
+
+        uint64_t offsetOf(size_t index) const noexcept { return dataOffset + uint64_t(index) * tileBytes; }
+    };
+
+    // Read - плитка только читается, Write - читается и изменяется,
+    // Overwrite - перезаписывается целиком (из файла не читается, обнулена)
+    enum TAccess { Read, Write, Overwrite };
+
+private:
+    struct TEntry {
+        TStore* store;
+        size_t index;
+        std::unique_ptr<char[]> data;
+        bool dirty;
+        size_t pins;
+    };
+
+    struct TKeyHash {
+        size_t operator()(const std::pair<const TStore*, size_t>& k) const noexcept {
+            return std::hash<const void*>()(k.first) ^ (k.second * 0x9E3779B97F4A7C15ull);
+        }
+    };
+
+    std::list<TEntry> lru; // В начале - недавно использованные
+    std::unordered_map<std::pair<const TStore*, size_t>, std::list<TEntry>::iterator, TKeyHash> index;
+    size_t budget;
+    size_t cached = 0;
+    TTileCacheStats st;
+
+    void writeBack(TEntry& e) {
+        if (e.dirty) {
+            e.store->file.writeAt(e.store->offsetOf(e.index), e.data.get(), e.store->tileBytes);
+            e.dirty = false;
+            st.writes++;
+        }
+    }
+
+    void evict() {
+        for (auto it = lru.end(); cached > budget && it != lru.begin();) {
+            --it;
+            if (it->pins != 0)
+                continue;
+            writeBack(*it);
+            cached -= it->store->tileBytes;
+            index.erase(std::make_pair(it->store, it->index));
+            it = lru.erase(it);
+        }
+    }
+
+public:
+    // Захваченная плитка; данные действительны, пока объект существует
+    class TPin {
+        TEntry* e = nullptr;
+
+    public:
+        TPin() = default;
+        explicit TPin(TEntry* entry) : e(entry) { e->pins++; }
+        TPin(TPin&& p) noexcept : e(p.e) { p.e = nullptr; }
+        TPin& operator=(TPin&& p) noexcept {
+            std::swap(e, p.e);
+            return *this;
+        }
+        TPin(const TPin&) = delete;
+        TPin& operator=(const TPin&) = delete;
+        ~TPin() {
+            if (e != nullptr)
+                e->pins--;
+        }
+
+        char* data() const noexcept { return e->data.get(); }
+    };
+
+    explicit TTileCache(size_t budgetBytes = size_t(256) << 20) : budget(budgetBytes) {}
+
+    TTileCache(const TTileCache&) = delete;
+    TTileCache& operator=(const TTileCache&) = delete;
+
+    ~TTileCache() {
+        for (TEntry& e : lru) {
+            try {
+                writeBack(e);
+            } catch (...) {
+            }
+        }
+    }
+
+    size_t capacity() const noexcept { return budget; }
+    size_t bytesCached() const noexcept { return cached; }
+    const TTileCacheStats& stats() const noexcept { return st; }
+    void resetStats() noexcept { st = TTileCacheStats(); }
+
+    void setCapacity(size_t budgetBytes) {
+        budget = budgetBytes;
+        evict();
+    }
+
+    TPin acquire(TStore& s, size_t tileIndex, TAccess access) {
+        auto found = index.find(std::make_pair(static_cast<const TStore*>(&s), tileIndex));
+        if (found != index.end()) {
+            st.hits++;
+            lru.splice(lru.begin(), lru, found->second);
+            TEntry& e = lru.front();
+            if (access == Overwrite)
+                std::memset(e.data.get(), 0, s.tileBytes);
+            if (access != Read)
+                e.dirty = true;
+            return TPin(&e);
+        }
+
+        std::unique_ptr<char[]> data(new char[s.tileBytes]);
+        if (access == Overwrite) {
+            std::memset(data.get(), 0, s.tileBytes);
+        } else {
+            s.file.readAt(s.offsetOf(tileIndex), data.get(), s.tileBytes);
+            st.reads++;
+        }
+        lru.push_front(TEntry{ &s, tileIndex, std::move(data), access != Read, 0 });
+        index[std::make_pair(static_cast<const TStore*>(&s), tileIndex)] = lru.begin();
+        cached += s.tileBytes;
+        TPin pin(&lru.front());
+        evict();
+        return pin;
+    }
+
+    // Записать измененные плитки хранилища s в файл
+    void flush(TStore& s) {
+        for (TEntry& e : lru) {
+            if (e.store == &s)
+                writeBack(e);
+        }
+    }
+
+    // Записать и забыть все плитки хранилища s
+    void drop(TStore& s) {
+        for (auto it = lru.begin(); it != lru.end();) {
+            if (it->store != &s) {
+                ++it;
+                continue;
+            }
+            writeBack(*it);
+            cached -= s.tileBytes;
+            index.erase(std::make_pair(static_cast<const TStore*>(&s), it->index));
+            it = lru.erase(it);
+        }
+    }
+
+    // Общий кэш (256 МБ по умолчанию)
+    static TTileCache& global() {
+        static TTileCache cache;
+        return cache;
+    }
+};
+
+// Матрица во внешней памяти -
+// квадратная матрица n x n в файле, разбитая на плитки tile x tile.
+// Плитки хранятся подряд по строкам плиток, каждая - по строкам; краевые
+// плитки дополнены нулями до полного размера. Размер не ограничен
+// MAX_MATRIX_SIZE и объемом памяти: в памяти находятся только плитки в
+// кэше. Формат файла - TBinaryHeader с layout == 1, затем плитки.
+template<typename T>
+class TDiskMatrix {
+    std::unique_ptr<TTileCache::TStore> store;
+    TTileCache* cache;
+    size_t n, tile, nt;
+
+    void setGeometry(size_t size, size_t tileSize) {
+        n = size;
+        tile = tileSize;
+        nt = (n + tile - 1) / tile;
+    }
+
+public:
+    // Новая матрица (нулевая) в файле path
+    TDiskMatrix(const std::string& path, size_t size, size_t tileSize = 256,
+                TTileCache& c = TTileCache::global()) : cache(&c) {
+        if (size == 0 || tileSize == 0)
+            throw std::out_of_range("Disk matrix and tile sizes should be greater than zero");
+        setGeometry(size, tileSize);
+        store.reset(new TTileCache::TStore(path, TFile::Create, sizeof(TBinaryHeader), tile * tile * sizeof(T)));
+        TBinaryHeader h = makeBinaryHeader<T>(2, n, n);
+        h.layout = 1;
+        h.tile = uint32_t(tile);
+        store->file.writeAt(0, &h, sizeof(h));
+        store->file.resize(store->offsetOf(nt * nt));
+    }
+
+    // Существующая матрица из файла path
+    explicit TDiskMatrix(const std::string& path, TTileCache& c = TTileCache::global()) : cache(&c) {
+        TFile probe(path, TFile::Read);
+        TBinaryHeader h;
+        if (probe.size() < sizeof(h))
+            throw std::runtime_error("Disk matrix file is truncated");
+        probe.readAt(0, &h, sizeof(h));
+        if (h.layout != 1 || h.tile == 0)
+            throw std::runtime_error("Not a tiled matrix file");
+        h.layout = 0;
+        checkBinaryHeader<T>(h, 2);
+        setGeometry(size_t(h.rows), h.tile);
+        store.reset(new TTileCache::TStore(path, TFile::ReadWrite, h.dataOffset, tile * tile * sizeof(T)));
+        if (store->file.size() < store->offsetOf(nt * nt))
+            throw std::runtime_error("Disk matrix file is truncated");
+    }
+
+    TDiskMatrix(TDiskMatrix&&) = default;
+    TDiskMatrix(const TDiskMatrix&) = delete;
+    TDiskMatrix& operator=(const TDiskMatrix&) = delete;
+
+    ~TDiskMatrix() {
+        if (store) {
+            try {
+                cache->drop(*store);
+            } catch (...) {
+            }
+        }
+    }
+
+    // Копия обычной матрицы во внешней памяти
+    static TDiskMatrix fromMatrix(const std::string& path, const TDynamicMatrix<T>& m, size_t tileSize = 256,
+                                  TTileCache& c = TTileCache::global()) {
+        TDiskMatrix res(path, m.size(), tileSize, c);
+        for (size_t ti = 0; ti < res.nt; ti++) {
+            for (size_t tj = 0; tj < res.nt; tj++) {
+                TTileCache::TPin pin = res.tileAt(ti, tj, TTileCache::Overwrite);
+                T* t = reinterpret_cast<T*>(pin.data());
+                for (size_t i = ti * tileSize; i < std::min(m.size(), (ti + 1) * tileSize); i++) {
+                    const T* row = m[i].data() + tj * tileSize;
+                    std::copy(row, row + std::min(tileSize, m.size() - tj * tileSize), t + (i - ti * tileSize) * tileSize);
+                }
+            }
+        }
+        return res;
+    }
+
+    // Копия в памяти (размер не больше MAX_MATRIX_SIZE)
+    TDynamicMatrix<T> toMatrix() const {
+        TDynamicMatrix<T> m(n);
+        for (size_t ti = 0; ti < nt; ti++) {
+            for (size_t tj = 0; tj < nt; tj++) {
+                TTileCache::TPin pin = tileAt(ti, tj, TTileCache::Read);
+                const T* t = reinterpret_cast<const T*>(pin.data());
+                for (size_t i = ti * tile; i < rowEnd(ti); i++) {
+                    const T* src = t + (i - ti * tile) * tile;
+                    std::copy(src, src + (rowEnd(tj) - tj * tile), m[i].data() + tj * tile);
+                }
+            }
+        }
+        return m;
+    }
+
+    size_t size() const noexcept { return n; }
+    size_t tileSize() const noexcept { return tile; }
+    size_t tileCount() const noexcept { return nt; } // Плиток по каждой стороне
+
+    // Конец диапазона строк (столбцов) плитки номер t
+    size_t rowEnd(size_t t) const noexcept { return std::min(n, (t + 1) * tile); }
+
+    TTileCache& tileCache() const noexcept { return *cache; }
+
+    // Плитка (ti, tj): tile x tile элементов по строкам
+    TTileCache::TPin tileAt(size_t ti, size_t tj, TTileCache::TAccess access) const {
+        if (ti >= nt || tj >= nt)
+            throw std::out_of_range("Tile index out of range");
+        return cache->acquire(*store, ti * nt + tj, access);
+    }
+
+    bool sameStorage(const TDiskMatrix& m) const noexcept { return store == m.store; }
+
+    // Поэлементный доступ через кэш
+    T get(size_t i, size_t j) const {
+        if (i >= n || j >= n)
+            throw std::out_of_range("Index out of range");
+        TTileCache::TPin pin = tileAt(i / tile, j / tile, TTileCache::Read);
+        return reinterpret_cast<const T*>(pin.data())[(i % tile) * tile + j % tile];
+    }
+
+    void set(size_t i, size_t j, const T& val) {
+        if (i >= n || j >= n)
+            throw std::out_of_range("Index out of range");
+        TTileCache::TPin pin = tileAt(i / tile, j / tile, TTileCache::Write);
+        reinterpret_cast<T*>(pin.data())[(i % tile) * tile + j % tile] = val;
+    }
+
+    // Записать измененные плитки в файл
+    void flush() {
+        cache->flush(*store);
+    }
+};
+
+// y = alpha * A * x + beta * y; каждая плитка A читается один раз
+template<typename T>
+void gemv(const T& alpha, const TDiskMatrix<T>& A, const TDynamicVector<T>& x, const T& beta, TDynamicVector<T>& y) {
+    const size_t n = A.size(), t = A.tileSize();
+    if (x.size() != n || y.size() != n)
+        throw std::invalid_argument("Matrix size and vector sizes must match for gemv");
+    if (&x == &y)
+        throw std::invalid_argument("gemv output vector must not alias the input vector");
+    T* py = y.data();
+    const T* px = x.data();
+    for (size_t i = 0; i < n; i++)
+        py[i] = beta == T() ? T() : py[i] * beta;
+    if (alpha == T())
+        return; // Плитки A не читаются
+    for (size_t ti = 0; ti < A.tileCount(); ti++) {
+        for (size_t tj = 0; tj < A.tileCount(); tj++) {
+            TTileCache::TPin pin = A.tileAt(ti, tj, TTileCache::Read);
+            const T* a = reinterpret_cast<const T*>(pin.data());
+            for (size_t i = ti * t; i < A.rowEnd(ti); i++) {
+                const T* row = a + (i - ti * t) * t;
+                T sum = T();
+                for (size_t j = tj * t; j < A.rowEnd(tj); j++)
+                    sum += row[j - tj * t] * px[j];
+                py[i] += alpha * sum;
+            }
+        }
+    }
+}
+
+// C = A + B по плиткам; C может совпадать с A или B
+template<typename T>
+void add(const TDiskMatrix<T>& A, const TDiskMatrix<T>& B, TDiskMatrix<T>& C) {
+    if (A.size() != B.size() || A.size() != C.size())
+        throw std::invalid_argument("Matrix sizes must match for add");
+    if (A.tileSize() != B.tileSize() || A.tileSize() != C.tileSize())
+        throw std::invalid_argument("Disk matrices must have equal tile sizes");
+    const size_t tt = A.tileSize() * A.tileSize();
+    const bool inPlace = C.sameStorage(A) || C.sameStorage(B);
+    for (size_t ti = 0; ti < A.tileCount(); ti++) {
+        for (size_t tj = 0; tj < A.tileCount(); tj++) {
+            TTileCache::TPin pc = C.tileAt(ti, tj, inPlace ? TTileCache::Write : TTileCache::Overwrite);
+            TTileCache::TPin pa = A.tileAt(ti, tj, TTileCache::Read);
+            TTileCache::TPin pb = B.tileAt(ti, tj, TTileCache::Read);
+            const T* a = reinterpret_cast<const T*>(pa.data());
+            const T* b = reinterpret_cast<const T*>(pb.data());
+            T* c = reinterpret_cast<T*>(pc.data());
+            for (size_t k = 0; k < tt; k++)
+                c[k] = a[k] + b[k];
+        }
+    }
+}
+
+// C = alpha * A * B + beta * C по плиткам.
+// Плитки C обрабатываются блоками b x b, которые остаются в кэше, пока по k
+// проходят строка плиток A и столбец плиток B, так что за весь расчет
+// читается примерно 2 * nt^3 / b плиток вместо 2 * nt^3. b выбирается по
+// бюджету кэша: b^2 плиток C и 2b плиток A и B. Соседние блоки проходят k в
+// противоположных направлениях, чтобы переиспользовать последние плитки.
+template<typename T>
+void gemm(const T& alpha, const TDiskMatrix<T>& A, const TDiskMatrix<T>& B, const T& beta, TDiskMatrix<T>& C) {
+    if (A.size() != B.size() || A.size() != C.size())
+        throw std::invalid_argument("Matrix sizes must match for gemm");
+    if (A.tileSize() != B.tileSize() || A.tileSize() != C.tileSize())
+        throw std::invalid_argument("Disk matrices must have equal tile sizes");
+    if (C.sameStorage(A) || C.sameStorage(B))
+        throw std::invalid_argument("gemm output matrix must not alias an input matrix");
+
+    const size_t t = A.tileSize(), nt = A.tileCount();
+    const size_t tileBytes = t * t * sizeof(T);
+    const size_t fit = C.tileCache().capacity() / tileBytes;
+    size_t b = size_t(std::sqrt(double(fit) + 1.0)) - 1;
+    b = std::max<size_t>(1, std::min(b, nt));
+
+    bool forward = true;
+    for (size_t bi = 0; bi < nt; bi += b) {
+        for (size_t bj = 0; bj < nt; bj += b) {
+            const size_t ei = std::min(nt, bi + b), ej = std::min(nt, bj + b);
+            std::vector<TTileCache::TPin> cPins;
+            for (size_t ti = bi; ti < ei; ti++) {
+                for (size_t tj = bj; tj < ej; tj++) {
+                    cPins.push_back(C.tileAt(ti, tj, beta == T() ? TTileCache::Overwrite : TTileCache::Write));
+                    if (beta != T() && beta != T(1)) {
+                        T* c = reinterpret_cast<T*>(cPins.back().data());
+                        for (size_t k = 0; k < t * t; k++)
+                            c[k] *= beta;
+                    }
+                }
+            }
+            if (alpha != T()) {
+                for (size_t step = 0; step < nt; step++) {
+                    const size_t tk = forward ? step : nt - 1 - step;
+                    const size_t kEnd = A.rowEnd(tk) - tk * t;
+                    std::vector<TTileCache::TPin> bPins;
+                    for (size_t tj = bj; tj < ej; tj++)
+                        bPins.push_back(B.tileAt(tk, tj, TTileCache::Read));
+                    for (size_t ti = bi; ti < ei; ti++) {
+                        TTileCache::TPin pa = A.tileAt(ti, tk, TTileCache::Read);
+                        const T* a = reinterpret_cast<const T*>(pa.data());
+                        const size_t iEnd = A.rowEnd(ti) - ti * t;
+                        for (size_t tj = bj; tj < ej; tj++) {
+                            const T* bt = reinterpret_cast<const T*>(bPins[tj - bj].data());
+                            T* c = reinterpret_cast<T*>(cPins[(ti - bi) * (ej - bj) + tj - bj].data());
+                            const size_t jEnd = A.rowEnd(tj) - tj * t;
+                            for (size_t i = 0; i < iEnd; i++) {
+                                T* crow = c + i * t;
+                                for (size_t k = 0; k < kEnd; k++) {
+                                    const T aik = alpha * a[i * t + k];
+                                    const T* brow = bt + k * t;
+                                    for (size_t j = 0; j < jEnd; j++)
+                                        crow[j] += aik * brow[j];
+                                }
+                            }
+                        }
+                    }
+                }
+                forward = !forward;
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,720 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Распределенные матрицы: блочное распределение по сетке процессов,
+// умножение SUMMA поверх сменного транспорта сообщений
+
+#ifndef __TDistributed_H__
+#define __TDistributed_H__
+
+#include "tmatrix.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <exception>
+#include <vector>
+#include <stdexcept>
+
+#if !defined(_WIN32)
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// Транспорт: обмен байтами между процессами группы с номерами 0..size()-1.
+// Сообщения между парой процессов доставляются в порядке отправки; send
+// может блокироваться, пока получатель не начнет прием. send и recv могут
+// вызываться одновременно из двух разных потоков.
+class TTransport {
+public:
+    virtual ~TTransport() {}
+
+    virtual size_t rank() const = 0;
+    virtual size_t size() const = 0;
+    virtual void send(size_t to, const void* data, size_t bytes) = 0;
+    virtual void recv(size_t from, void* data, size_t bytes) = 0;
+};
+
+#if !defined(_WIN32)
+// Транспорт поверх потоковых сокетов, по одному на каждого собеседника.
+// Сокеты можно соединить как угодно (TCP между машинами, Unix-сокеты);
+// localGroup создает группу на одной машине из пар Unix-сокетов - ее
+// участников можно раздать потокам или процессам после fork.
+class TSocketTransport : public TTransport {
+    size_t me;
+    std::vector<int> peers; // peers[r] - сокет к процессу r, для себя -1
+
+public:
+    // Транспорт владеет сокетами и закрывает их
+    TSocketTransport(size_t rank, std::vector<int> sockets) : me(rank), peers(std::move(sockets)) {
+        if (me >= peers.size())
+            throw std::out_of_range("Transport rank out of range");
+    }
+
+    TSocketTransport(const TSocketTransport&) = delete;
+    TSocketTransport& operator=(const TSocketTransport&) = delete;
+
+    ~TSocketTransport() {
+        for (int fd : peers) {
+            if (fd >= 0)
+                close(fd);
+        }
+    }
+
+    size_t rank() const override { return me; }
+    size_t size() const override { return peers.size(); }
+
+    void send(size_t to, const void* data, size_t bytes) override {
+        const char* p = static_cast<const char*>(data);
+        while (bytes != 0) {
+            ssize_t done = ::send(peer(to), p, bytes, MSG_NOSIGNAL);
+            if (done < 0 && errno == EINTR)
+                continue;
+            if (done <= 0)
+                throw std::runtime_error("Transport send failed");
+            p += done;
+            bytes -= size_t(done);
+        }
+    }
+
+    void recv(size_t from, void* data, size_t bytes) override {
+        char* p = static_cast<char*>(data);
+        while (bytes != 0) {
+            ssize_t done = ::recv(peer(from), p, bytes, 0);
+            if (done < 0 && errno == EINTR)
+                continue;
+            if (done <= 0)
+                throw std::runtime_error("Transport receive failed");
+            p += done;
+            bytes -= size_t(done);
+        }
+    }
+
+    // Группа из n участников, связанных попарно
+    static std::vector<std::unique_ptr<TSocketTransport>> localGroup(size_t n) {
+        std::vector<std::vector<int>> fds(n, std::vector<int>(n, -1));
+        std::vector<std::unique_ptr<TSocketTransport>> res;
+        try {
+            for (size_t a = 0; a < n; a++) {
+                for (size_t b = a + 1; b < n; b++) {
+                    int sv[2];
+                    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+                        throw std::runtime_error("Cannot create local transport sockets");
+                    fds[a][b] = sv[0];
+                    fds[b][a] = sv[1];
+                }
+            }
+            for (size_t r = 0; r < n; r++) {
+                res.emplace_back(new TSocketTransport(r, fds[r]));
+                fds[r].clear();
+            }
+        } catch (...) {
+            for (auto& row : fds) {
+                for (int fd : row) {
+                    if (fd >= 0)
+                        close(fd);
+                }
+            }
+            throw;
+        }
+        return res;
+    }
+
+private:
+    int peer(size_t r) const {
+        if (r >= peers.size() || peers[r] < 0)
+            throw std::out_of_range("Transport peer out of range");
+        return peers[r];
+    }
+};
+#endif
+
+// Рассылка bytes байтов от group[root] всем процессам group биномиальным
+// деревом: log2(group.size()) шагов вместо group.size() - 1 отправок корня.
+// Вызывается всеми участниками group.
+inline void broadcast(TTransport& t, const std::vector<size_t>& group, size_t root, void* data, size_t bytes) {
+    const size_t g = group.size();
+    size_t me = g;
+    for (size_t k = 0; k < g; k++) {
+        if (group[k] == t.rank())
+            me = k;
+    }
+    if (me == g || root >= g)
+        throw std::invalid_argument("Broadcast group must contain the caller and the root");
+    if (bytes == 0)
+        return;
+    const size_t v = (me + g - root) % g; // Номер относительно корня
+    size_t mask = 1;
+    for (; mask < g; mask <<= 1) {
+        if (v & mask) {
+            t.recv(group[(v - mask + root) % g], data, bytes);
+            break;
+        }
+    }
+    for (mask >>= 1; mask > 0; mask >>= 1) {
+        if (v + mask < g)
+            t.send(group[(v + mask + root) % g], data, bytes);
+    }
+}
+
+// Сетка процессов rows x cols; процесс r стоит в строке r / cols, столбце r % cols
+struct TProcessGrid {
+    size_t rows, cols;
+
+    // Сетка, близкая к квадратной
+    static TProcessGrid square(size_t p) {
+        if (p == 0)
+            throw std::invalid_argument("Process grid needs at least one process");
+        size_t r = size_t(std::sqrt(double(p)));
+        while (r > 1 && p % r != 0)
+            r--;
+        return TProcessGrid{ r, p / r };
+    }
+
+    size_t size() const noexcept { return rows * cols; }
+    size_t row(size_t rank) const noexcept { return rank / cols; }
+    size_t col(size_t rank) const noexcept { return rank % cols; }
+    size_t rankOf(size_t i, size_t j) const noexcept { return i * cols + j; }
+
+    bool operator==(const TProcessGrid& g) const noexcept { return rows == g.rows && cols == g.cols; }
+    bool operator!=(const TProcessGrid& g) const noexcept { return !(*this == g); }
+};
+
+// Начало части k из parts равных частей [0, n)
+inline size_t blockBegin(size_t n, size_t parts, size_t k) noexcept {
+    return n * k / parts;
+}
+
+// Номер части, содержащей индекс i
+inline size_t blockOwner(size_t n, size_t parts, size_t i) noexcept {
+    size_t k = std::min(parts - 1, i * parts / n);
+    while (blockBegin(n, parts, k) > i)
+        k--;
+    while (blockBegin(n, parts, k + 1) <= i)
+        k++;
+    return k;
+}
+
+// Прямоугольный блок rows x cols в непрерывной памяти; строки - векторы
+// над ней, поэтому блок годится для операций над окнами
+template<typename T>
+class TLocalBlock {
+    std::vector<T> buf;
+    std::vector<TDynamicVector<T>> rowVec;
+    size_t nRows, nCols;
+
+public:
+    TLocalBlock(size_t rows, size_t cols) : buf(rows * cols), nRows(rows), nCols(cols) {
+        rowVec.reserve(rows);
+        for (size_t i = 0; i < rows; i++)
+            rowVec.emplace_back(buf.data() + i * cols, cols, adopt);
+    }
+
+    TLocalBlock(const TLocalBlock&) = delete;
+    TLocalBlock& operator=(const TLocalBlock&) = delete;
+    TLocalBlock(TLocalBlock&&) = default; // Буфер не перемещается, строки остаются верны
+    TLocalBlock& operator=(TLocalBlock&&) = default;
+
+    size_t rows() const noexcept { return nRows; }
+    size_t cols() const noexcept { return nCols; }
+    T* data() noexcept { return buf.data(); }
+    const T* data() const noexcept { return buf.data(); }
+    T* row(size_t i) noexcept { return buf.data() + i * nCols; }
+    const T* row(size_t i) const noexcept { return buf.data() + i * nCols; }
+
+    TMatrixView<T> view() const {
+        return TMatrixView<T>(const_cast<TDynamicVector<T>*>(rowVec.data()), 0, 0, nRows, nCols);
+    }
+};
+
+// Матрица n x n, распределенная блоками по сетке процессов: процесс
+// (pi, pj) хранит строки [rowBegin, rowEnd) и столбцы [colBegin, colEnd).
+// Сетка p x 1 дает распределение по строкам.
+// Объект на каждом процессе описывает свою часть; коллективные операции
+// (scatter, gather, gemm) вызываются всеми процессами сетки.
+template<typename T>
+class TDistributedMatrix {
+    size_t n;
+    TProcessGrid grid;
+    size_t me;
+    size_t r0, r1, c0, c1;
+    TLocalBlock<T> blk;
+
+public:
+    TDistributedMatrix(size_t size, const TProcessGrid& g, size_t rank)
+        : n(size), grid(g), me(rank),
+          r0(blockBegin(size, g.rows, g.row(rank))), r1(blockBegin(size, g.rows, g.row(rank) + 1)),
+          c0(blockBegin(size, g.cols, g.col(rank))), c1(blockBegin(size, g.cols, g.col(rank) + 1)),
+          blk(r1 - r0, c1 - c0) {
+        if (rank >= g.size())
+            throw std::out_of_range("Process rank out of grid");
+        if (size < g.rows || size < g.cols)
+            throw std::invalid_argument("Matrix is smaller than the process grid");
+    }
+
+    size_t size() const noexcept { return n; }
+    const TProcessGrid& processGrid() const noexcept { return grid; }
+    size_t rank() const noexcept { return me; }
+
+    size_t rowBegin() const noexcept { return r0; }
+    size_t rowEnd() const noexcept { return r1; }
+    size_t colBegin() const noexcept { return c0; }
+    size_t colEnd() const noexcept { return c1; }
+
+    TLocalBlock<T>& local() noexcept { return blk; }
+    const TLocalBlock<T>& local() const noexcept { return blk; }
+
+    // Элемент (i, j) матрицы из своего блока
+    T& at(size_t i, size_t j) {
+        if (i < r0 || i >= r1 || j < c0 || j >= c1)
+            throw std::out_of_range("Element is not stored by this process");
+        return blk.row(i - r0)[j - c0];
+    }
+
+    // Заполнить свой блок значениями f(i, j)
+    template<typename F>
+    void fill(F f) {
+        for (size_t i = r0; i < r1; i++)
+            for (size_t j = c0; j < c1; j++)
+                blk.row(i - r0)[j - c0] = f(i, j);
+    }
+
+    // Раздать блоки матрицы m с процесса root (m читается только на нем)
+    void scatter(TTransport& t, const TDynamicMatrix<T>& m, size_t root = 0) {
+        checkTransport(t);
+        if (me != root) {
+            t.recv(root, blk.data(), blk.rows() * blk.cols() * sizeof(T));
+            return;
+        }
+        if (m.size() != n)
+            throw std::invalid_argument("Matrix size must match distributed matrix size");
+        for (size_t r = 0; r < grid.size(); r++) {
+            TDistributedMatrix part(n, grid, r);
+            for (size_t i = part.r0; i < part.r1; i++)
+                std::copy(m[i].data() + part.c0, m[i].data() + part.c1, part.blk.row(i - part.r0));
+            if (r == me)
+                std::copy(part.blk.data(), part.blk.data() + part.blk.rows() * part.blk.cols(), blk.data());
+            else
+                t.send(r, part.blk.data(), part.blk.rows() * part.blk.cols() * sizeof(T));
+        }
+    }
+
+    // Собрать матрицу на процессе root; на остальных результат - матрица 1 x 1
+    TDynamicMatrix<T> gather(TTransport& t, size_t root = 0) const {
+        checkTransport(t);
+        if (me != root) {
+            t.send(root, blk.data(), blk.rows() * blk.cols() * sizeof(T));
+            return TDynamicMatrix<T>(1);
+        }
+        TDynamicMatrix<T> m(n);
+        for (size_t r = 0; r < grid.size(); r++) {
+            TDistributedMatrix part(n, grid, r);
+            if (r == me)
+                std::copy(blk.data(), blk.data() + blk.rows() * blk.cols(), part.blk.data());
+            else
+                t.recv(r, part.blk.data(), part.blk.rows() * part.blk.cols() * sizeof(T));
+            for (size_t i = part.r0; i < part.r1; i++)
+                std::copy(part.blk.row(i - part.r0), part.blk.row(i - part.r0) + part.blk.cols(), m[i].data() + part.c0);
+        }
+        return m;
+    }
+
+    void checkTransport(const TTransport& t) const {
+        if (t.size() != grid.size() || t.rank() != me)
+            throw std::invalid_argument("Transport does not match the process grid");
+    }
+
+    bool sameDistribution(const TDistributedMatrix& m) const noexcept {
+        return n == m.n && grid == m.grid && me == m.me;
+    }
+};
+
+// C = alpha * A * B + beta * C по алгоритму SUMMA. Индекс k проходится
+// панелями шириной не больше panel: владельцы столбцов A рассылают панель
+// A вдоль своей строки сетки, владельцы строк B - панель B вдоль столбца,
+// и каждый процесс добавляет произведение панелей к своему блоку C.
+// Память процесса - его блоки и две панели, обмен на процесс - O(n^2 / sqrt(p)).
+template<typename T>
+void gemm(TTransport& t, const T& alpha, const TDistributedMatrix<T>& A, const TDistributedMatrix<T>& B,
+          const T& beta, TDistributedMatrix<T>& C, size_t panel = 64) {
+    if (!A.sameDistribution(B) || !A.sameDistribution(C))
+        throw std::invalid_argument("Distributed matrices must share size and process grid for gemm");
+    if (&C == &A || &C == &B)
+        throw std::invalid_argument("gemm output matrix must not alias an input matrix");
+    if (panel == 0)
+        throw std::invalid_argument("Panel width should be greater than zero");
+    C.checkTransport(t);
+
+    const TProcessGrid& g = C.processGrid();
+    const size_t n = C.size(), pi = g.row(t.rank()), pj = g.col(t.rank());
+    std::vector<size_t> rowGroup(g.cols), colGroup(g.rows);
+    for (size_t j = 0; j < g.cols; j++)
+        rowGroup[j] = g.rankOf(pi, j);
+    for (size_t i = 0; i < g.rows; i++)
+        colGroup[i] = g.rankOf(i, pj);
+
+    const size_t myRows = C.rowEnd() - C.rowBegin(), myCols = C.colEnd() - C.colBegin();
+    std::unique_ptr<TLocalBlock<T>> ap, bp;
+    bool first = true;
+    for (size_t k0 = 0; k0 < n;) {
+        const size_t qa = blockOwner(n, g.cols, k0); // Столбец сетки со столбцами A панели
+        const size_t qb = blockOwner(n, g.rows, k0); // Строка сетки со строками B панели
+        const size_t k1 = std::min({ k0 + panel, blockBegin(n, g.cols, qa + 1), blockBegin(n, g.rows, qb + 1) });
+        const size_t w = k1 - k0;
+        if (!ap || ap->cols() != w) {
+            ap.reset(new TLocalBlock<T>(myRows, w));
+            bp.reset(new TLocalBlock<T>(w, myCols));
+        }
+        if (pj == qa) {
+            for (size_t i = 0; i < myRows; i++)
+                std::copy_n(A.local().row(i) + (k0 - A.colBegin()), w, ap->row(i));
+        }
+        if (pi == qb) {
+            for (size_t p = 0; p < w; p++)
+                std::copy_n(B.local().row(k0 - B.rowBegin() + p), myCols, bp->row(p));
+        }
+        broadcast(t, rowGroup, qa, ap->data(), myRows * w * sizeof(T));
+        broadcast(t, colGroup, qb, bp->data(), w * myCols * sizeof(T));
+        gemm(alpha, ap->view(), bp->view(), first ? beta : T(1), C.local().view());
+        first = false;
+        k0 = k1;
+    }
+}
+
+// Обмен со всеми процессами: send(q) для всех q != rank() выполняется в
+// фоновом потоке, recv(q) для всех q по возрастанию (включая свой номер) -
+// в вызывающем. Процесс, ждущий сообщения от q, уже принял все сообщения
+// от меньших номеров, поэтому ожидания не зацикливаются при любом объеме
+// сообщений, а вызывающий поток может считать, пока идут передачи.
+template<typename Send, typename Recv>
+void exchange(TTransport& t, Send send, Recv recv) {
+    const size_t p = t.size(), me = t.rank();
+    std::exception_ptr sendError;
+    std::thread sender;
+    if (p > 1) {
+        sender = std::thread([&] {
+            try {
+                for (size_t k = 1; k < p; k++)
+                    send((me + k) % p);
+            } catch (...) {
+                sendError = std::current_exception();
+            }
+        });
+    }
+    try {
+        for (size_t q = 0; q < p; q++)
+            recv(q);
+    } catch (...) {
+        if (sender.joinable())
+            sender.join();
+        throw;
+    }
+    if (sender.joinable())
+        sender.join();
+    if (sendError)
+        std::rethrow_exception(sendError);
+}
+
+// Вектор длины n, распределенный по procs процессам: процесс r хранит
+// элементы [begin, end) - те же номера, что и строки матрицы, распределенной
+// по сетке procs x 1
+template<typename T>
+class TDistributedVector {
+    size_t n, procs, me;
+    size_t r0, r1;
+    TDynamicVector<T> v;
+
+public:
+    TDistributedVector(size_t size, size_t processes, size_t rank)
+        : n(size), procs(processes), me(rank),
+          r0(blockBegin(size, processes, rank)), r1(blockBegin(size, processes, rank + 1)),
+          v(r1 > r0 ? r1 - r0 : 1) {
+        if (rank >= processes)
+            throw std::out_of_range("Process rank out of range");
+        if (size < processes)
+            throw std::invalid_argument("Vector is smaller than the number of processes");
+    }
+
+    size_t size() const noexcept { return n; }
+    size_t processes() const noexcept { return procs; }
+    size_t rank() const noexcept { return me; }
+    size_t begin() const noexcept { return r0; }
+    size_t end() const noexcept { return r1; }
+
+    // Своя часть: элемент i вектора - local()[i - begin()]
+    TDynamicVector<T>& local() noexcept { return v; }
+    const TDynamicVector<T>& local() const noexcept { return v; }
+
+    template<typename F>
+    void fill(F f) {
+        for (size_t i = r0; i < r1; i++)
+            v[i - r0] = f(i);
+    }
+
+    void scatter(TTransport& t, const TDynamicVector<T>& full, size_t root = 0) {
+        checkTransport(t);
+        if (me != root) {
+            t.recv(root, v.data(), (r1 - r0) * sizeof(T));
+            return;
+        }
+        if (full.size() != n)
+            throw std::invalid_argument("Vector size must match distributed vector size");
+        for (size_t r = 0; r < procs; r++) {
+            const T* part = full.data() + blockBegin(n, procs, r);
+            const size_t len = blockBegin(n, procs, r + 1) - blockBegin(n, procs, r);
+            if (r == me)
+                std::copy(part, part + len, v.data());
+            else
+                t.send(r, part, len * sizeof(T));
+        }
+    }
+
+    // Собрать вектор на процессе root; на остальных результат - вектор длины 1
+    TDynamicVector<T> gather(TTransport& t, size_t root = 0) const {
+        checkTransport(t);
+        if (me != root) {
+            t.send(root, v.data(), (r1 - r0) * sizeof(T));
+            return TDynamicVector<T>(1);
+        }
+        TDynamicVector<T> full(n);
+        for (size_t r = 0; r < procs; r++) {
+            T* part = full.data() + blockBegin(n, procs, r);
+            const size_t len = blockBegin(n, procs, r + 1) - blockBegin(n, procs, r);
+            if (r == me)
+                std::copy(v.data(), v.data() + len, part);
+            else
+                t.recv(r, part, len * sizeof(T));
+        }
+        return full;
+    }
+
+    void checkTransport(const TTransport& t) const {
+        if (t.size() != procs || t.rank() != me)
+            throw std::invalid_argument("Transport does not match the vector distribution");
+    }
+};
+
+// Какие элементы x чужих частей передаются в gemv
+enum class THaloMode {
+    Sparse, // Только в столбцах с ненулевыми элементами A (см. THaloPlan)
+    Full    // Все, без построения плана: для отладки и сравнения
+};
+
+// План обмена гало для произведения матрицы, распределенной по строкам
+// (сетка p x 1), на вектор. Процессу передаются только те элементы x, в
+// столбцах которых у его строк есть ненулевые элементы; план один раз
+// выясняет эти номера и сообщает их владельцам. Пропущенные слагаемые -
+// нули при конечных x, и сумма от них не меняется; неконечные элементы x
+// вне плана gemv пересылает отдельно (см. gemv). THaloMode::Full передает
+// чужие части x целиком. Построение - коллективная операция; после
+// изменения расположения нулей в матрице план строится заново.
+class THaloPlan {
+    size_t n, procs, me;
+    std::vector<std::vector<size_t>> need; // need[q] - номера столбцов, получаемых от q
+    std::vector<std::vector<size_t>> give; // give[q] - номера своих элементов, отправляемых q
+
+    template<typename T> friend void gemv(TTransport&, const THaloPlan&, const T&, const TDistributedMatrix<T>&,
+                                          const TDistributedVector<T>&, const T&, TDistributedVector<T>&);
+
+public:
+    template<typename T>
+    THaloPlan(TTransport& t, const TDistributedMatrix<T>& A, THaloMode mode = THaloMode::Sparse)
+        : n(A.size()), procs(A.processGrid().size()), me(A.rank()), need(procs), give(procs) {
+        if (A.processGrid().cols != 1)
+            throw std::invalid_argument("Halo exchange needs a matrix distributed by rows");
+        A.checkTransport(t);
+        if (mode == THaloMode::Full) {
+            // Обмениваться номерами не нужно: каждый отдает всю свою часть
+            for (size_t q = 0; q < procs; q++) {
+                if (q == me)
+                    continue;
+                for (size_t j = blockBegin(n, procs, q); j < blockBegin(n, procs, q + 1); j++)
+                    need[q].push_back(j);
+                for (size_t j = blockBegin(n, procs, me); j < blockBegin(n, procs, me + 1); j++)
+                    give[q].push_back(j);
+            }
+            return;
+        }
+        const TLocalBlock<T>& a = A.local();
+        std::vector<char> used(n, 0);
+        for (size_t i = 0; i < a.rows(); i++) {
+            const T* row = a.row(i);
+            for (size_t j = 0; j < n; j++) {
+                if (row[j] != T())
+                    used[j] = 1;
+            }
+        }
+        for (size_t q = 0; q < procs; q++) {
+            if (q == me)
+                continue;
+            for (size_t j = blockBegin(n, procs, q); j < blockBegin(n, procs, q + 1); j++) {
+                if (used[j])
+                    need[q].push_back(j);
+            }
+        }
+        exchange(t, [&](size_t q) {
+            uint64_t count = need[q].size();
+            t.send(q, &count, sizeof(count));
+            std::vector<uint64_t> idx(need[q].begin(), need[q].end());
+            t.send(q, idx.data(), idx.size() * sizeof(uint64_t));
+        }, [&](size_t q) {
+            if (q == me)
+                return;
+            uint64_t count = 0;
+            t.recv(q, &count, sizeof(count));
+            std::vector<uint64_t> idx(static_cast<size_t>(count));
+            t.recv(q, idx.data(), idx.size() * sizeof(uint64_t));
+            for (uint64_t j : idx) {
+                if (j < blockBegin(n, procs, me) || j >= blockBegin(n, procs, me + 1))
+                    throw std::runtime_error("Halo request for an element owned by another process");
+                give[q].push_back(size_t(j));
+            }
+        });
+    }
+
+    // Элементов x, получаемых от других процессов за одно умножение
+    size_t haloSize() const noexcept {
+        size_t res = 0;
+        for (const auto& v : need)
+            res += v.size();
+        return res;
+    }
+};
+
+// y = alpha * A * x + beta * y для матрицы, распределенной по строкам.
+// Элементы x отправляются в фоновом потоке, а чужие части принимаются по
+// возрастанию номеров столбцов, и вклад каждой части считается, пока
+// передаются следующие. Суммы по строке накапливаются в том же порядке,
+// что и в gemv для TDynamicMatrix, и результат с ним совпадает. Сумма
+// начинается с +0 и поэтому не бывает -0, так что пропущенные планом
+// слагаемые 0 * x при конечных x ее не меняют. Неконечные же (0 * NaN и
+// 0 * Inf - NaN) владелец досылает к плановым: перед значениями идет число
+// таких элементов и их номера, и получатель вставляет их в ряд столбцов.
+// При alpha == 0 обмена нет вовсе: alpha одинаково у всех процессов, и все
+// они только масштабируют свою часть y.
+template<typename T>
+void gemv(TTransport& t, const THaloPlan& plan, const T& alpha, const TDistributedMatrix<T>& A,
+          const TDistributedVector<T>& x, const T& beta, TDistributedVector<T>& y) {
+    const size_t n = A.size(), p = plan.procs, me = plan.me;
+    if (x.size() != n || y.size() != n || plan.n != n)
+        throw std::invalid_argument("Matrix size and vector sizes must match for gemv");
+    if (A.processGrid().cols != 1 || A.processGrid().rows != p || A.rank() != me ||
+        x.processes() != p || x.rank() != me || y.processes() != p || y.rank() != me)
+        throw std::invalid_argument("Matrix, vectors and halo plan must share the row distribution");
+    if (&x == &y)
+        throw std::invalid_argument("gemv output vector must not alias the input vector");
+    A.checkTransport(t);
+
+    T* ys = y.local().data();
+    if (alpha == T()) {
+        for (size_t i = 0; i < y.end() - y.begin(); i++)
+            ys[i] = beta == T() ? T() : beta * ys[i];
+        return;
+    }
+
+    const TLocalBlock<T>& a = A.local();
+    const size_t rows = a.rows(), r0 = x.begin();
+    const T* xs = x.local().data();
+    // Неконечные значения бывают только у типов с NaN/Inf
+    constexpr bool checkFinite = std::numeric_limits<T>::has_quiet_NaN || std::numeric_limits<T>::has_infinity;
+    std::vector<size_t> nonFinite; // Номера своих неконечных элементов x
+    if constexpr (checkFinite) {
+        for (size_t j = r0; j < x.end(); j++) {
+            if (!std::isfinite(xs[j - r0]))
+                nonFinite.push_back(j);
+        }
+    }
+    // Плановые номера idx и досылаемые extra одним рядом по возрастанию
+    auto merge = [](const std::vector<size_t>& idx, const std::vector<uint64_t>& extra) {
+        std::vector<size_t> res(idx.size() + extra.size());
+        std::merge(idx.begin(), idx.end(), extra.begin(), extra.end(), res.begin());
+        return res;
+    };
+    std::vector<T> acc(rows, T()), halo;
+    exchange(t, [&](size_t q) {
+        const std::vector<size_t>* idx = &plan.give[q];
+        std::vector<size_t> merged;
+        if constexpr (checkFinite) {
+            std::vector<uint64_t> extra;
+            for (size_t j : nonFinite) {
+                if (!std::binary_search(idx->begin(), idx->end(), j))
+                    extra.push_back(j);
+            }
+            uint64_t count = extra.size();
+            t.send(q, &count, sizeof(count));
+            if (count != 0) {
+                t.send(q, extra.data(), extra.size() * sizeof(uint64_t));
+                merged = merge(*idx, extra);
+                idx = &merged;
+            }
+        }
+        if (idx->size() == x.end() - r0) {
+            t.send(q, xs, idx->size() * sizeof(T));
+        } else if (!idx->empty()) {
+            std::vector<T> buf(idx->size());
+            for (size_t k = 0; k < idx->size(); k++)
+                buf[k] = xs[(*idx)[k] - r0];
+            t.send(q, buf.data(), buf.size() * sizeof(T));
+        }
+    }, [&](size_t q) {
+        const size_t c0 = blockBegin(n, p, q), c1 = blockBegin(n, p, q + 1);
+        const std::vector<size_t>* idx = &plan.need[q];
+        std::vector<size_t> merged;
+        const T* seg = xs;
+        if (q != me) {
+            if constexpr (checkFinite) {
+                uint64_t count = 0;
+                t.recv(q, &count, sizeof(count));
+                if (count != 0) {
+                    if (count > c1 - c0)
+                        throw std::runtime_error("Halo message lists more elements than the sender owns");
+                    std::vector<uint64_t> extra(static_cast<size_t>(count));
+                    t.recv(q, extra.data(), extra.size() * sizeof(uint64_t));
+                    for (uint64_t j : extra) {
+                        if (j < c0 || j >= c1)
+                            throw std::runtime_error("Halo element is not owned by its sender");
+                    }
+                    merged = merge(*idx, extra);
+                    idx = &merged;
+                }
+            }
+            if (idx->empty())
+                return;
+            halo.resize(idx->size());
+            t.recv(q, halo.data(), halo.size() * sizeof(T));
+            seg = halo.data();
+            if (idx->size() != c1 - c0) {
+                for (size_t i = 0; i < rows; i++) {
+                    const T* row = a.row(i);
+                    T sum = acc[i];
+                    for (size_t k = 0; k < idx->size(); k++)
+                        sum += row[(*idx)[k]] * seg[k];
+                    acc[i] = sum;
+                }
+                return;
+            }
+        }
+        for (size_t i = 0; i < rows; i++) {
+            const T* row = a.row(i) + c0;
+            T sum = acc[i];
+            for (size_t j = 0; j < c1 - c0; j++)
+                sum += row[j] * seg[j];
+            acc[i] = sum;
+        }
+    });
+
+    for (size_t i = 0; i < rows; i++) {
+        if (beta == T())
+            ys[i] = alpha * acc[i];
+        else
+            ys[i] = alpha * acc[i] + beta * ys[i];
+    }
+}
+
+#endif
@@ -0,0 +1,544 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Обмен матрицами с внешними инструментами: NumPy .npy и MatrixMarket
+
+#ifndef __TExchange_H__
+#define __TExchange_H__
+
+#include "tmatrixio.h"
+
+#include <limits>
+#include <sstream>
+#include <cctype>
+
+// Тип элемента .npy: порядок байтов, вид и размер ("<f8", "|u1", ">i4")
+struct TNpyType {
+    char byteOrder; // '<', '>' или '|'
+    char kind;      // 'f', 'i', 'u'
+    size_t size;
+
+    static bool nativeLittle() noexcept {
+        const uint16_t one = 1;
+        unsigned char first;
+        std::memcpy(&first, &one, 1);
+        return first == 1;
+    }
+
+    // Нужно ли переставлять байты при чтении на этой машине
+    bool swapped() const noexcept {
+        return size > 1 && (byteOrder == '<') != nativeLittle();
+    }
+
+    template<typename T>
+    static TNpyType of() {
+        return TNpyType{ sizeof(T) == 1 ? '|' : nativeLittle() ? '<' : '>',
+                         char(TBinaryElement<T>::kind), sizeof(T) };
+    }
+
+    template<typename T>
+    bool isNative() const noexcept {
+        return kind == char(TBinaryElement<T>::kind) && size == sizeof(T) && !swapped();
+    }
+
+    std::string descr() const {
+        return std::string(1, byteOrder) + kind + std::to_string(size);
+    }
+};
+
+// Заголовок .npy: тип, порядок хранения, форма и смещение данных
+struct TNpyHeader {
+    TNpyType type;
+    bool fortranOrder;
+    std::vector<size_t> shape;
+    size_t dataOffset;
+};
+
+// Разбор словаря заголовка вида
+// {'descr': '<f8', 'fortran_order': False, 'shape': (3, 3), }
+inline TNpyHeader parseNpyDict(const std::string& dict, size_t dataOffset) {
+    auto valueOf = [&](const char* key) {
+        size_t k = dict.find(std::string("'") + key + "'");
+        if (k == std::string::npos)
+            throw std::runtime_error(std::string("NPY header has no '") + key + "' entry");
+        size_t colon = dict.find(':', k);
+        if (colon == std::string::npos)
+            throw std::runtime_error("Malformed NPY header");
+        return dict.find_first_not_of(" \t", colon + 1);
+    };
+
+    TNpyHeader h;
+    h.dataOffset = dataOffset;
+
+    size_t d = valueOf("descr");
+    size_t dEnd = d == std::string::npos ? d : dict.find(dict[d], d + 1);
+    if (dEnd == std::string::npos || (dict[d] != '\'' && dict[d] != '"') || dEnd - d < 4)
+        throw std::runtime_error("Malformed NPY dtype");
+    std::string descr = dict.substr(d + 1, dEnd - d - 1);
+    h.type.byteOrder = descr[0] == '=' ? (TNpyType::nativeLittle() ? '<' : '>') : descr[0];
+    h.type.kind = descr[1];
+    if ((h.type.byteOrder != '<' && h.type.byteOrder != '>' && h.type.byteOrder != '|') ||
+        (h.type.kind != 'f' && h.type.kind != 'i' && h.type.kind != 'u'))
+        throw std::runtime_error("Unsupported NPY dtype: " + descr);
+    h.type.size = std::strtoul(descr.c_str() + 2, nullptr, 10);
+    if (h.type.size != 1 && h.type.size != 2 && h.type.size != 4 && h.type.size != 8)
+        throw std::runtime_error("Unsupported NPY dtype: " + descr);
+    if (h.type.kind == 'f' && h.type.size < 4)
+        throw std::runtime_error("Unsupported NPY dtype: " + descr);
+
+    size_t f = valueOf("fortran_order");
+    if (dict.compare(f, 4, "True") == 0)
+        h.fortranOrder = true;
+    else if (dict.compare(f, 5, "False") == 0)
+        h.fortranOrder = false;
+    else
+        throw std::runtime_error("Malformed NPY fortran_order");
+
+    size_t s = valueOf("shape");
+    size_t sEnd = s == std::string::npos ? s : dict.find(')', s);
+    if (sEnd == std::string::npos || dict[s] != '(')
+        throw std::runtime_error("Malformed NPY shape");
+    const char* p = dict.c_str() + s + 1;
+    const char* last = dict.c_str() + sEnd;
+    while (p < last) {
+        while (p < last && (*p == ' ' || *p == ','))
+            p++;
+        if (p == last)
+            break;
+        size_t dim;
+        const char* q = parseTextNumber(p, last, dim);
+        if (q == nullptr)
+            throw std::runtime_error("Malformed NPY shape");
+        while (q < last && (*q == 'L' || *q == ' '))
+            q++;
+        h.shape.push_back(dim);
+        p = q;
+    }
+    return h;
+}
+
+// Чтение заголовка из первых байт файла (магическая строка, версия, словарь)
+inline TNpyHeader readNpyHeader(istream& istr) {
+    unsigned char pre[8];
+    if (!istr.read(reinterpret_cast<char*>(pre), 8) || std::memcmp(pre, "\x93NUMPY", 6) != 0)
+        throw std::runtime_error("Not an NPY file");
+    size_t lenBytes = pre[6] == 1 ? 2 : (pre[6] == 2 || pre[6] == 3) ? 4 : 0;
+    if (lenBytes == 0)
+        throw std::runtime_error("Unsupported NPY format version");
+    unsigned char lb[4] = {};
+    if (!istr.read(reinterpret_cast<char*>(lb), std::streamsize(lenBytes)))
+        throw std::runtime_error("NPY header is truncated");
+    size_t len = size_t(lb[0]) | size_t(lb[1]) << 8 | size_t(lb[2]) << 16 | size_t(lb[3]) << 24;
+    std::string dict(len, '\0');
+    if (!istr.read(&dict[0], std::streamsize(len)))
+        throw std::runtime_error("NPY header is truncated");
+    return parseNpyDict(dict, 8 + lenBytes + len);
+}
+
+// Проверка формы: n для вектора (rank 1), n x n для матрицы (rank 2)
+inline size_t npySize(const TNpyHeader& h, size_t rank) {
+    if (h.shape.size() != rank || (rank == 2 && h.shape[0] != h.shape[1]))
+        throw std::runtime_error(rank == 1 ? "NPY array is not a vector" : "NPY array is not a square matrix");
+    return h.shape[0];
+}
+
+// Преобразование n элементов типа файла в T: store(k, value)
+template<typename T, typename F>
+void decodeNpyElements(const char* src, const TNpyType& type, size_t n, F store) {
+    auto decode = [&](auto sample) {
+        typedef decltype(sample) S;
+        for (size_t k = 0; k < n; k++) {
+            unsigned char bytes[sizeof(S)];
+            std::memcpy(bytes, src + k * sizeof(S), sizeof(S));
+            if (type.swapped())
+                std::reverse(bytes, bytes + sizeof(S));
+            S val;
+            std::memcpy(&val, bytes, sizeof(S));
+            store(k, T(val));
+        }
+    };
+    switch (type.kind == 'f' ? type.size : type.kind == 'i' ? 16 + type.size : 32 + type.size) {
+    case 4: decode(float()); break;
+    case 8: decode(double()); break;
+    case 16 + 1: decode(int8_t()); break;
+    case 16 + 2: decode(int16_t()); break;
+    case 16 + 4: decode(int32_t()); break;
+    case 16 + 8: decode(int64_t()); break;
+    case 32 + 1: decode(uint8_t()); break;
+    case 32 + 2: decode(uint16_t()); break;
+    case 32 + 4: decode(uint32_t()); break;
+    case 32 + 8: decode(uint64_t()); break;
+    default: throw std::runtime_error("Unsupported NPY dtype: " + type.descr());
+    }
+}
+
+// Запись: версия 1.0, данные по строкам в родном типе и порядке байтов,
+// заголовок дополняется пробелами до границы 64 байт
+inline void writeNpyHeader(ostream& ostr, const TNpyType& type, const std::string& shape) {
+    std::string dict = "{'descr': '" + type.descr() + "', 'fortran_order': False, 'shape': " + shape + ", }";
+    size_t total = 10 + dict.size() + 1;
+    dict.append((64 - total % 64) % 64, ' ');
+    dict.push_back('\n');
+    unsigned char pre[10] = { 0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0,
+                              (unsigned char)(dict.size() & 0xFF), (unsigned char)(dict.size() >> 8) };
+    ostr.write(reinterpret_cast<const char*>(pre), 10);
+    ostr.write(dict.data(), std::streamsize(dict.size()));
+}
+
+template<typename T>
+void writeNpy(ostream& ostr, const TDynamicVector<T>& v) {
+    writeNpyHeader(ostr, TNpyType::of<T>(), "(" + std::to_string(v.size()) + ",)");
+    ostr.write(reinterpret_cast<const char*>(v.data()), std::streamsize(v.size() * sizeof(T)));
+    if (!ostr)
+        throw std::runtime_error("Failed to write NPY vector");
+}
+
+template<typename T>
+void writeNpy(ostream& ostr, const TDynamicMatrix<T>& m) {
+    writeNpyHeader(ostr, TNpyType::of<T>(), "(" + std::to_string(m.size()) + ", " + std::to_string(m.size()) + ")");
+    for (size_t i = 0; i < m.size(); i++) {
+        ostr.write(reinterpret_cast<const char*>(m[i].data()), std::streamsize(m.size() * sizeof(T)));
+    }
+    if (!ostr)
+        throw std::runtime_error("Failed to write NPY matrix");
+}
+
+// Чтение с копированием: любой поддерживаемый числовой тип файла
+// преобразуется в T, порядок байтов и порядок Fortran учитываются
+template<typename T>
+TDynamicVector<T> readNpyVector(istream& istr) {
+    TNpyHeader h = readNpyHeader(istr);
+    TDynamicVector<T> v(npySize(h, 1));
+    std::vector<char> buf(v.size() * h.type.size);
+    if (!istr.read(buf.data(), std::streamsize(buf.size())))
+        throw std::runtime_error("NPY data is truncated");
+    decodeNpyElements<T>(buf.data(), h.type, v.size(), [&](size_t k, T val) { v[k] = val; });
+    return v;
+}
+
+template<typename T>
+TDynamicMatrix<T> readNpyMatrix(istream& istr) {
+    TNpyHeader h = readNpyHeader(istr);
+    size_t n = npySize(h, 2);
+    TDynamicMatrix<T> m(n);
+    std::vector<char> buf(n * h.type.size);
+    for (size_t i = 0; i < n; i++) {
+        if (!istr.read(buf.data(), std::streamsize(buf.size())))
+            throw std::runtime_error("NPY data is truncated");
+        if (h.fortranOrder)
+            decodeNpyElements<T>(buf.data(), h.type, n, [&](size_t k, T val) { m[k][i] = val; });
+        else
+            decodeNpyElements<T>(buf.data(), h.type, n, [&](size_t k, T val) { m[i][k] = val; });
+    }
+    return m;
+}
+
+template<typename T>
+void saveNpy(const std::string& path, const TDynamicVector<T>& v) {
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    if (!f)
+        throw std::runtime_error("Cannot open file for writing: " + path);
+    writeNpy(f, v);
+}
+
+template<typename T>
+void saveNpy(const std::string& path, const TDynamicMatrix<T>& m) {
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    if (!f)
+        throw std::runtime_error("Cannot open file for writing: " + path);
+    writeNpy(f, m);
+}
+
+template<typename T>
+TDynamicVector<T> loadNpyVector(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f)
+        throw std::runtime_error("Cannot open file for reading: " + path);
+    return readNpyVector<T>(f);
+}
+
+template<typename T>
+TDynamicMatrix<T> loadNpyMatrix(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f)
+        throw std::runtime_error("Cannot open file for reading: " + path);
+    return readNpyMatrix<T>(f);
+}
+
+// Заголовок отображенного .npy, пригодного для работы без копирования:
+// тип совпадает с T (включая порядок байтов), порядок хранения - по строкам
+template<typename T>
+TNpyHeader mappedNpyHeader(const TMappedFile& f, size_t rank) {
+    std::istringstream in(std::string(f.data(), std::min<size_t>(f.size(), 1 << 16)), std::ios::in | std::ios::binary);
+    TNpyHeader h = readNpyHeader(in);
+    size_t n = npySize(h, rank);
+    if (!h.type.isNative<T>() || (rank == 2 && h.fortranOrder))
+        throw std::runtime_error("NPY dtype or order does not match; use loadNpy to convert");
+    if (h.dataOffset % alignof(T) != 0)
+        throw std::runtime_error("NPY data is not aligned for mapping");
+    if (f.size() < h.dataOffset || (n != 0 && (f.size() - h.dataOffset) / sizeof(T) / n < (rank == 2 ? n : 1)))
+        throw std::runtime_error("NPY data is truncated");
+    return h;
+}
+
+// Вектор и матрица прямо на страницах отображенного .npy (см. TMappedMatrix)
+template<typename T>
+class TNpyMappedVector {
+    TMappedFile file;
+    TNpyHeader header;
+    TDynamicVector<T> v;
+
+public:
+    explicit TNpyMappedVector(const std::string& path, bool writable = false)
+        : file(path, writable), header(mappedNpyHeader<T>(file, 1)),
+          v(reinterpret_cast<T*>(file.data() + header.dataOffset), header.shape[0], adopt) {}
+
+    TDynamicVector<T>& vector() noexcept { return v; }
+    const TDynamicVector<T>& vector() const noexcept { return v; }
+};
+
+template<typename T>
+class TNpyMappedMatrix {
+    TMappedFile file;
+    TNpyHeader header;
+    TDynamicMatrix<T> m;
+
+public:
+    explicit TNpyMappedMatrix(const std::string& path, bool writable = false)
+        : file(path, writable), header(mappedNpyHeader<T>(file, 2)),
+          m(reinterpret_cast<T*>(file.data() + header.dataOffset), header.shape[0], adopt) {}
+
+    TDynamicMatrix<T>& matrix() noexcept { return m; }
+    const TDynamicMatrix<T>& matrix() const noexcept { return m; }
+};
+
+// MatrixMarket: формат coordinate (разреженный, индексы с единицы) и
+// array (плотный, по столбцам); поля real, integer и pattern; симметрии
+// general, symmetric, skew-symmetric и hermitian (для вещественных = symmetric)
+enum class TMatrixMarketFormat { Coordinate, Array };
+
+// Потоковое чтение MatrixMarket: next() выдает элементы по одному, не
+// собирая матрицу; симметричные элементы выдаются парами.
+template<typename T>
+class TMatrixMarketReader {
+    istream& istr;
+    std::string buf;
+    size_t line = 0;
+    size_t nRows = 0, nCols = 0, entries = 0, done = 0;
+    TMatrixMarketFormat format;
+    bool pattern = false;
+    int symmetry = 0; // 0 - general, 1 - symmetric, -1 - skew-symmetric
+    size_t ai = 0, aj = 0; // Позиция следующего элемента формата array
+    bool havePending = false;
+    size_t pi = 0, pj = 0;
+    T pv = T();
+
+    // Следующая непустая строка, не являющаяся комментарием
+    bool nextLine() {
+        while (std::getline(istr, buf)) {
+            line++;
+            const char* p = skipTextSpace(buf.data(), buf.data() + buf.size());
+            if (p != buf.data() + buf.size() && *p != '%')
+                return true;
+        }
+        return false;
+    }
+
+    void number(const char*& p, size_t& val) {
+        const char* last = buf.data() + buf.size();
+        p = skipTextSpace(p, last);
+        const char* q = parseTextNumber(p, last, val);
+        if (q == nullptr || (q != last && !isTextSpace(*q)))
+            throw TTextParseError("Invalid MatrixMarket integer", line, size_t(p - buf.data()) + 1);
+        p = q;
+    }
+
+    void value(const char*& p, T& val) {
+        const char* last = buf.data() + buf.size();
+        p = skipTextSpace(p, last);
+        const char* q = parseTextNumber(p, last, val);
+        if (q == nullptr || (q != last && !isTextSpace(*q)))
+            throw TTextParseError("Invalid MatrixMarket value", line, size_t(p - buf.data()) + 1);
+        p = q;
+    }
+
+public:
+    explicit TMatrixMarketReader(istream& in) : istr(in) {
+        if (!std::getline(istr, buf))
+            throw TTextParseError("Missing MatrixMarket banner", 1, 1);
+        line = 1;
+        std::istringstream banner(buf);
+        std::string magic, object, fmt, field, sym;
+        banner >> magic >> object >> fmt >> field >> sym;
+        auto lower = [](std::string s) {
+            for (char& c : s)
+                c = char(std::tolower((unsigned char)c));
+            return s;
+        };
+        object = lower(object); fmt = lower(fmt); field = lower(field); sym = lower(sym);
+        if (magic != "%%MatrixMarket" || object != "matrix")
+            throw TTextParseError("Not a MatrixMarket matrix", 1, 1);
+        if (fmt == "coordinate")
+            format = TMatrixMarketFormat::Coordinate;
+        else if (fmt == "array")
+            format = TMatrixMarketFormat::Array;
+        else
+            throw TTextParseError("Unsupported MatrixMarket format '" + fmt + "'", 1, 1);
+        if (field == "pattern" && format == TMatrixMarketFormat::Coordinate)
+            pattern = true;
+        else if (field != "real" && field != "integer")
+            throw TTextParseError("Unsupported MatrixMarket field '" + field + "'", 1, 1);
+        if (sym == "symmetric" || sym == "hermitian")
+            symmetry = 1;
+        else if (sym == "skew-symmetric")
+            symmetry = -1;
+        else if (sym != "general")
+            throw TTextParseError("Unsupported MatrixMarket symmetry '" + sym + "'", 1, 1);
+
+        if (!nextLine())
+            throw TTextParseError("Missing MatrixMarket size line", line + 1, 1);
+        const char* p = buf.data();
+        number(p, nRows);
+        number(p, nCols);
+        if (format == TMatrixMarketFormat::Coordinate) {
+            number(p, entries);
+        } else {
+            // Для симметричных хранится только нижний треугольник
+            entries = symmetry == 0 ? nRows * nCols : symmetry == 1 ? nRows * (nRows + 1) / 2 : nRows * (nRows - 1) / 2;
+            ai = symmetry == -1 ? 1 : 0;
+        }
+        if (symmetry != 0 && nRows != nCols)
+            throw TTextParseError("Symmetric MatrixMarket matrix must be square", line, 1);
+    }
+
+    size_t rows() const noexcept { return nRows; }
+    size_t cols() const noexcept { return nCols; }
+    size_t size() const noexcept { return entries; }
+    TMatrixMarketFormat storage() const noexcept { return format; }
+
+    // Следующий элемент (индексы с нуля); false - элементы кончились
+    bool next(size_t& i, size_t& j, T& val) {
+        if (havePending) {
+            havePending = false;
+            i = pi; j = pj; val = pv;
+            return true;
+        }
+        if (done == entries)
+            return false;
+        if (!nextLine())
+            throw TTextParseError("MatrixMarket data ends early", line + 1, 1);
+        const char* p = buf.data();
+        if (format == TMatrixMarketFormat::Coordinate) {
+            const char* start = skipTextSpace(p, buf.data() + buf.size());
+            number(p, i);
+            number(p, j);
+            if (i == 0 || j == 0 || i > nRows || j > nCols)
+                throw TTextParseError("MatrixMarket index out of range", line, size_t(start - buf.data()) + 1);
+            i--; j--;
+            if (pattern)
+                val = T(1);
+            else
+                value(p, val);
+        } else {
+            // По столбцам, для симметричных - только нижний треугольник
+            i = ai;
+            j = aj;
+            if (++ai == nRows) {
+                aj++;
+                ai = symmetry == 0 ? 0 : symmetry == 1 ? aj : aj + 1;
+            }
+            value(p, val);
+        }
+        if (skipTextSpace(p, buf.data() + buf.size()) != buf.data() + buf.size())
+            throw TTextParseError("Unexpected data after MatrixMarket entry", line, size_t(p - buf.data()) + 1);
+        done++;
+        if (symmetry != 0 && i != j) {
+            havePending = true;
+            pi = j; pj = i;
+            pv = symmetry == 1 ? val : T(-val);
+        }
+        return true;
+    }
+};
+
+template<typename T>
+TDynamicMatrix<T> readMatrixMarket(istream& istr) {
+    TMatrixMarketReader<T> reader(istr);
+    if (reader.rows() != reader.cols())
+        throw std::runtime_error("MatrixMarket matrix is not square");
+    TDynamicMatrix<T> m(reader.rows());
+    size_t i, j;
+    T val;
+    while (reader.next(i, j, val))
+        m[i][j] = val;
+    return m;
+}
+
+// Запись: coordinate - только ненулевые элементы, array - все по столбцам.
+// Вещественные числа пишутся с max_digits10 знаками, чтобы чтение
+// восстанавливало их точно.
+template<typename T>
+void writeMatrixMarket(ostream& ostr, const TDynamicMatrix<T>& m,
+                       TMatrixMarketFormat format = TMatrixMarketFormat::Coordinate) {
+    const size_t n = m.size();
+    const bool coordinate = format == TMatrixMarketFormat::Coordinate;
+    ostr << "%%MatrixMarket matrix " << (coordinate ? "coordinate " : "array ")
+         << (std::is_floating_point<T>::value ? "real" : "integer") << " general\n";
+    if (coordinate) {
+        size_t nnz = 0;
+        for (size_t i = 0; i < n; i++)
+            nnz += size_t(n - std::count(m[i].data(), m[i].data() + n, T()));
+        ostr << n << ' ' << n << ' ' << nnz << '\n';
+    } else {
+        ostr << n << ' ' << n << '\n';
+    }
+
+    std::streamsize precision = ostr.precision();
+    if (std::is_floating_point<T>::value)
+        ostr.precision(std::numeric_limits<T>::max_digits10);
+    {
+        // coordinate пишется по строкам матрицы, array - по столбцам, как требует формат
+        TTextWriter w(ostr);
+        for (size_t a = 0; a < n; a++) {
+            for (size_t b = 0; b < n; b++) {
+                if (coordinate) {
+                    const T& val = m[a][b];
+                    if (val == T())
+                        continue;
+                    w.number(a + 1);
+                    w.put(' ');
+                    w.number(b + 1);
+                    w.put(' ');
+                    w.number(val);
+                } else {
+                    w.number(m[b][a]);
+                }
+                w.put('\n');
+            }
+        }
+        w.flush();
+    }
+    ostr.precision(precision);
+    if (!ostr)
+        throw std::runtime_error("Failed to write MatrixMarket matrix");
+}
+
+template<typename T>
+void saveMatrixMarket(const std::string& path, const TDynamicMatrix<T>& m,
+                      TMatrixMarketFormat format = TMatrixMarketFormat::Coordinate) {
+    std::ofstream f(path, std::ios::trunc);
+    if (!f)
+        throw std::runtime_error("Cannot open file for writing: " + path);
+    writeMatrixMarket(f, m, format);
+}
+
+template<typename T>
+TDynamicMatrix<T> loadMatrixMarket(const std::string& path) {
+    std::ifstream f(path);
+    if (!f)
+        throw std::runtime_error("Cannot open file for reading: " + path);
+    return readMatrixMarket<T>(f);
+}
+
+#endif
@@ -0,0 +1,182 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// LU-разложение с выбором ведущего элемента по столбцу: решение систем,
+// определитель, обратная матрица
+
+#ifndef __TLU_H__
+#define __TLU_H__
+
+#include "tmatrix.h"
+#include "ttriangular.h"
+
+#include <cmath>
+#include <utility>
+#include <vector>
+#include <stdexcept>
+#include <type_traits>
+
+// Разложение P * A = L * U, L - нижняя треугольная с единицами на
+// диагонали, U - верхняя; обе хранятся в одной матрице на месте A.
+// Разложение блочное правостороннее: столбцы обрабатываются панелями
+// ширины block, панель раскладывается построчными операциями, затем
+// вычисляется блочная строка U и оставшаяся часть матрицы обновляется
+// произведением A22 -= L21 * U12 через gemm над окнами, строки которого
+// делятся между потоками пула. Почти вся работа приходится на это
+// обновление, поэтому скорость близка к скорости gemm.
+template<typename T>
+class TLU {
+    static_assert(std::is_floating_point<T>::value, "LU decomposition needs a floating point element type");
+
+    TDynamicMatrix<T> lu;
+    std::vector<size_t> piv; // На шаге k строка k переставлена со строкой piv[k]
+    bool odd = false;        // Нечетное число перестановок
+    bool zeroPivot = false;
+
+    void factorPanel(size_t k0, size_t kb) {
+        const size_t n = lu.size();
+        for (size_t j = k0; j < k0 + kb; j++) {
+            size_t p = j;
+            T best = std::abs(lu[j][j]);
+            for (size_t i = j + 1; i < n; i++) {
+                if (std::abs(lu[i][j]) > best) {
+                    best = std::abs(lu[i][j]);
+                    p = i;
+                }
+            }
+            piv[j] = p;
+            if (p != j) {
+                std::swap(lu[j], lu[p]); // Обмен буферов строк, без копирования
+                odd = !odd;
+            }
+            if (best == T()) {
+                zeroPivot = true;
+                continue;
+            }
+            const T* u = lu[j].data();
+            const T d = u[j];
+            for (size_t i = j + 1; i < n; i++) {
+                T* a = lu[i].data();
+                const T l = a[j] /= d;
+                for (size_t c = j + 1; c < k0 + kb; c++)
+                    a[c] -= l * u[c];
+            }
+        }
+    }
+
+public:
+    explicit TLU(const TDynamicMatrix<T>& a, size_t block = 32, TThreadPool& pool = TThreadPool::global())
+        : lu(a), piv(a.size()) {
+        if (block == 0)
+            throw std::invalid_argument("Block size should be greater than zero");
+        lu.setCopyOnWrite(false);
+        const size_t n = lu.size();
+        for (size_t k0 = 0; k0 < n; k0 += block) {
+            const size_t kb = std::min(block, n - k0), k1 = k0 + kb;
+            factorPanel(k0, kb);
+            if (k1 == n)
+                break;
+            // U12 = L11^-1 * A12
+            for (size_t i = k0 + 1; i < k1; i++) {
+                T* a = lu[i].data();
+                for (size_t p = k0; p < i; p++) {
+                    const T l = a[p];
+                    const T* u = lu[p].data();
+                    for (size_t c = k1; c < n; c++)
+                        a[c] -= l * u[c];
+                }
+            }
+            // A22 -= L21 * U12
+            TMatrixView<T> v = lu.view();
+            TMatrixView<T> L21 = v.submatrix(k1, k0, n - k1, kb), U12 = v.submatrix(k0, k1, kb, n - k1);
+            pool.parallelFor(0, n - k1, [&](size_t lo, size_t hi, size_t) {
+                if (lo < hi)
+                    gemm(T(-1), L21.rowRange(lo, hi - lo), U12, T(1), v.submatrix(k1 + lo, k1, hi - lo, n - k1));
+            });
+        }
+    }
+
+    size_t size() const noexcept { return lu.size(); }
+
+    // L (ниже диагонали) и U (диагональ и выше) в одной матрице
+    const TDynamicMatrix<T>& factors() const noexcept { return lu; }
+    const std::vector<size_t>& pivots() const noexcept { return piv; }
+
+    // Встретился нулевой ведущий элемент: матрица вырождена
+    bool singular() const noexcept { return zeroPivot; }
+
+    T determinant() const {
+        if (zeroPivot)
+            return T();
+        T det = odd ? T(-1) : T(1);
+        for (size_t i = 0; i < lu.size(); i++)
+            det *= lu[i][i];
+        return det;
+    }
+
+    // Решение A * x = b
+    TDynamicVector<T> solve(const TDynamicVector<T>& b) const {
+        const size_t n = lu.size();
+        if (b.size() != n)
+            throw std::invalid_argument("Matrix size and vector size must match for solve");
+        if (zeroPivot)
+            throw std::runtime_error("Matrix is singular");
+        TDynamicVector<T> x(b);
+        x.setCopyOnWrite(false);
+        T* px = x.data();
+        for (size_t k = 0; k < n; k++)
+            std::swap(px[k], px[piv[k]]);
+        trsv(TTriangle::Lower, lu, x, TDiagonal::Unit);
+        trsv(TTriangle::Upper, lu, x);
+        return x;
+    }
+
+    // Решение A * X = B для всех столбцов B сразу блочными trsm
+    TDynamicMatrix<T> solve(const TDynamicMatrix<T>& b, TThreadPool& pool = TThreadPool::global()) const {
+        const size_t n = lu.size();
+        if (b.size() != n)
+            throw std::invalid_argument("Matrix sizes must match for solve");
+        if (zeroPivot)
+            throw std::runtime_error("Matrix is singular");
+        TDynamicMatrix<T> x(b);
+        x.setCopyOnWrite(false);
+        for (size_t k = 0; k < n; k++) {
+            if (piv[k] != k)
+                std::swap(x[k], x[piv[k]]);
+        }
+        trsm(TTriangle::Lower, T(1), lu, x, TDiagonal::Unit, pool);
+        trsm(TTriangle::Upper, T(1), lu, x, TDiagonal::NonUnit, pool);
+        return x;
+    }
+
+    TDynamicMatrix<T> inverse(TThreadPool& pool = TThreadPool::global()) const {
+        const size_t n = lu.size();
+        TDynamicMatrix<T> e(n);
+        for (size_t i = 0; i < n; i++)
+            e[i][i] = T(1);
+        return solve(e, pool);
+    }
+};
+
+template<typename T>
+TDynamicVector<T> solve(const TDynamicMatrix<T>& A, const TDynamicVector<T>& b) {
+    return TLU<T>(A).solve(b);
+}
+
+template<typename T>
+TDynamicMatrix<T> solve(const TDynamicMatrix<T>& A, const TDynamicMatrix<T>& B) {
+    return TLU<T>(A).solve(B);
+}
+
+template<typename T>
+T determinant(const TDynamicMatrix<T>& A) {
+    return TLU<T>(A).determinant();
+}
+
+template<typename T>
+TDynamicMatrix<T> inverse(const TDynamicMatrix<T>& A) {
+    return TLU<T>(A).inverse();
+}
+
+#endif
@@ -11,12 +11,52 @@
 #include <stdexcept>
 #include <cassert>
 #include <algorithm>
+#include <utility>
+#include <type_traits>
+#include <memory>
+#include <new>
+#include <atomic>
+#include <functional>
+
+#include "tparallel.h"
+#include "tmemory.h"
+#include "ttextio.h"
 
 using namespace std;
 
 const int MAX_VECTOR_SIZE = 100000000;
 const int MAX_MATRIX_SIZE = 10000;
 
+// Наибольший размер, для которого умножение выполняется
+// специализированными ядрами с полностью развернутыми циклами
+#ifndef TMATRIX_SMALL_KERNEL_MAX
+#define TMATRIX_SMALL_KERNEL_MAX 16
+#endif
+
+// Развертывание цикла на этапе компиляции: f(integral_constant<size_t, I>) для I = 0..N-1
+template<typename F, size_t... I>
+constexpr void static_for_impl(F&& f, std::index_sequence<I...>) {
+    (f(std::integral_constant<size_t, I>()), ...);
+}
+
+template<size_t N, typename F>
+constexpr void static_for(F&& f) {
+    static_for_impl(f, std::make_index_sequence<N>());
+}
+
+// Признак конструктора, который не копирует переданный массив, а работает
+// прямо с ним (внешняя память: буферы сети, отображенные файлы и т.п.).
+// Такой объект не владеет памятью и не освобождает ее; массив должен
+// пережить объект.
+struct TAdopt {};
+constexpr TAdopt adopt{};
+
+template<typename T> class TDynamicVector;
+
+// Вектор ли T (строки матрицы - векторы)
+template<typename T> struct is_dynamic_vector : std::false_type {};
+template<typename T> struct is_dynamic_vector<TDynamicVector<T>> : std::true_type {};
+
 // Динамический вектор - 
 // шаблонный вектор на динамической памяти
 template<typename T>
@@ -24,66 +64,261 @@ class TDynamicVector {
 protected:
     size_t sz;
     T* pMem;
+    std::pmr::memory_resource* pRes; // Источник памяти для pMem; nullptr - память внешняя
+    std::atomic<size_t>* pRefs = nullptr; // Счетчик владельцев pMem в режиме копирования при записи
+
+    // Выделение памяти из r под n элементов и создание их через init(p, i).
+    // Если init бросает исключение, уже созданные элементы уничтожаются.
+    template<typename Init>
+    static T* create(std::pmr::memory_resource* r, size_t n, Init&& init) {
+        T* p = static_cast<T*>(r->allocate(n * sizeof(T), alignof(T)));
+        size_t i = 0;
+        try {
+            for (; i < n; i++)
+                init(p + i, i);
+        } catch (...) {
+            std::destroy_n(p, i);
+            r->deallocate(p, n * sizeof(T), alignof(T));
+            throw;
+        }
+        return p;
+    }
+
+    static void destroy(std::pmr::memory_resource* r, T* p, size_t n) noexcept {
+        if (p == nullptr || r == nullptr)
+            return;
+        std::destroy_n(p, n);
+        r->deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    // Копия элемента src в p; элементы, умеющие работать с источником
+    // памяти (строки матрицы), получают тот же источник r
+    static void construct_copy(T* p, const T& src, std::pmr::memory_resource* r) {
+        if constexpr (std::is_constructible_v<T, const T&, std::pmr::memory_resource*>)
+            new (p) T(src, r);
+        else
+            new (p) T(src);
+    }
+
+    static T* create_copy(std::pmr::memory_resource* r, const T* src, size_t n) {
+        return create(r, n, [&](T* p, size_t i) { construct_copy(p, src[i], r); });
+    }
+
+    // Лежат ли данные во внешней памяти: сам вектор над внешним массивом
+    // или матрица над внешними строками. Присваивание такому объекту
+    // пишет значения на место, а не заменяет память.
+    bool wraps_external() const noexcept {
+        if (pMem == nullptr)
+            return false;
+        if (pRes == nullptr)
+            return true;
+        if constexpr (is_dynamic_vector<T>::value)
+            return !pMem[0].owns();
+        return false;
+    }
+
+    // Присваивание объекту над внешней памятью: размер должен совпадать
+    void check_external_assign(size_t n) const {
+        if (n != sz)
+            throw std::invalid_argument("Assignment over external memory must keep the size");
+    }
+
+    // Источник памяти для результатов операций
+    std::pmr::memory_resource* result_resource() const noexcept {
+        return pRes ? pRes : currentMemoryResource();
+    }
+
+    // Отказ от своей доли буфера; последний владелец его освобождает
+    void release() noexcept {
+        if (pRefs != nullptr) {
+            if (pRefs->fetch_sub(1, std::memory_order_acq_rel) != 1)
+                return;
+            delete pRefs;
+        }
+        destroy(pRes, pMem, sz);
+    }
+
+    // Получение собственного буфера перед изменением разделяемого
+    void detach() {
+        if (pRefs == nullptr || pRefs->load(std::memory_order_acquire) == 1)
+            return;
+        std::atomic<size_t>* refs = new std::atomic<size_t>(1);
+        T* fresh;
+        try {
+            fresh = create_copy(pRes, pMem, sz);
+        } catch (...) {
+            delete refs;
+            throw;
+        }
+        release();
+        pMem = fresh;
+        pRefs = refs;
+    }
+
 public:
 
     //Конструктор по умолчанию
-    TDynamicVector(size_t size = 1) : sz(size) {
+    TDynamicVector(size_t size = 1, std::pmr::memory_resource* r = currentMemoryResource()) : sz(size), pRes(r) {
         if (sz == 0)
             throw out_of_range("Vector size should be greater than zero");
         if (sz > MAX_VECTOR_SIZE)
             throw std::out_of_range("Vector size exceeds MAX_VECTOR_SIZE");
-        pMem = new T[sz](); // Инициализация значениями по умолчанию
+        pMem = create(pRes, sz, [](T* p, size_t) { new (p) T(); }); // Инициализация значениями по умолчанию
     }
 
     //Конструктор с существующим массивом
-    TDynamicVector(T* arr, size_t s) : sz(s) {
+    TDynamicVector(T* arr, size_t s, std::pmr::memory_resource* r = currentMemoryResource()) : sz(s), pRes(r) {
         assert(arr != nullptr && "TDynamicVector ctor requires non-nullptr arg");
-        pMem = new T[sz];
-        std::copy(arr, arr + sz, pMem);
+        pMem = create_copy(pRes, arr, sz);
+    }
+
+    //Конструктор над внешним массивом без копирования
+    TDynamicVector(T* arr, size_t s, TAdopt) : sz(s), pMem(arr), pRes(nullptr) {
+        assert(arr != nullptr && "TDynamicVector ctor requires non-nullptr arg");
+        if (sz == 0)
+            throw out_of_range("Vector size should be greater than zero");
+        if (sz > MAX_VECTOR_SIZE)
+            throw std::out_of_range("Vector size exceeds MAX_VECTOR_SIZE");
+    }
+
+    //Конструктор, принимающий во владение массив из s созданных элементов,
+    //выделенный из r
+    TDynamicVector(T* arr, size_t s, std::pmr::memory_resource* r, TAdopt) : sz(s), pMem(arr), pRes(r) {
+        assert(arr != nullptr && r != nullptr && "TDynamicVector ctor requires non-nullptr args");
     }
 
-    //Конструктор копирования
-    TDynamicVector(const TDynamicVector& v) : sz(v.sz) {
-        pMem = new T[sz];
-        std::copy(v.pMem, v.pMem + sz, pMem);
+    //Конструктор копирования; копия берет память из текущего источника потока,
+    //а в режиме копирования при записи разделяет буфер с v
+    TDynamicVector(const TDynamicVector& v)
+        : TDynamicVector(v, v.pRefs ? v.pRes : currentMemoryResource()) {}
+
+    //Конструктор копирования в заданный источник памяти. Копия вектора в
+    //режиме копирования при записи тоже работает в этом режиме и, если
+    //источник тот же, разделяет с ним буфер.
+    TDynamicVector(const TDynamicVector& v, std::pmr::memory_resource* r) : sz(v.sz), pRes(r) {
+        if (v.pRefs != nullptr && v.pRes == r) {
+            pMem = v.pMem;
+            pRefs = v.pRefs;
+            pRefs->fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        pMem = create_copy(pRes, v.pMem, sz);
+        if (v.pRefs != nullptr) {
+            try {
+                pRefs = new std::atomic<size_t>(1);
+            } catch (...) {
+                destroy(pRes, pMem, sz);
+                throw;
+            }
+        }
     }
 
     //Конструктор перемещения
-    TDynamicVector(TDynamicVector&& v) noexcept : sz(v.sz), pMem(v.pMem) {
+    TDynamicVector(TDynamicVector&& v) noexcept : sz(v.sz), pMem(v.pMem), pRes(v.pRes), pRefs(v.pRefs) {
         v.sz = 0;
         v.pMem = nullptr;
+        v.pRefs = nullptr;
     }
 
     ~TDynamicVector() {
-        delete[] pMem;
+        release();
     }
 
-    //Оператор копирующего присваивания
+    //Оператор копирующего присваивания; источник памяти не меняется.
+    //При равных размерах значения копируются на место, иначе выделяется
+    //новая память. Во внешнюю память (вектор или строки матрицы над
+    //внешним массивом) значения всегда пишутся на место, и размер должен
+    //совпадать.
     TDynamicVector& operator=(const TDynamicVector& v) {
         if (this == &v) return *this; // Защита от самоприсваивания
-        T* tmp = new T[v.sz];
-        std::copy(v.pMem, v.pMem + v.sz, tmp);
-        delete[] pMem; // Освобождаем старую память
+        if (pRefs != nullptr && v.pRefs != nullptr && v.pRes == pRes) {
+            // Оба в режиме копирования при записи: разделяем буфер v вместо
+            // копирования. Вектор не в этом режиме в него не переходит, и
+            // ссылки на его элементы остаются ссылками на его память
+            v.pRefs->fetch_add(1, std::memory_order_relaxed);
+            release();
+            pMem = v.pMem;
+            sz = v.sz;
+            pRefs = v.pRefs;
+            return *this;
+        }
+        if (wraps_external())
+            check_external_assign(v.sz);
+        detach();
+        if (sz == v.sz) {
+            std::copy(v.pMem, v.pMem + sz, pMem);
+            return *this;
+        }
+        std::pmr::memory_resource* r = result_resource();
+        T* tmp = create_copy(r, v.pMem, v.sz);
+        destroy(pRes, pMem, sz); // Освобождаем старую память (после detach она только наша)
         pMem = tmp;
+        pRes = r;
         sz = v.sz;
         return *this;
     }
 
-    //Оператор перемещающего присваивания
-    TDynamicVector& operator=(TDynamicVector&& v) noexcept {
+    //Оператор перемещающего присваивания; память переходит вместе со своим
+    //источником. Объекту над внешней памятью значения передаются на место,
+    //как при копирующем присваивании: v = a + b пишет во внешний массив.
+    TDynamicVector& operator=(TDynamicVector&& v) {
         if (this == &v) return *this; // Защита от самоприсваивания
-        delete[] pMem; // Освобождаем старую память
+        if (wraps_external()) {
+            check_external_assign(v.sz);
+            detach();
+            std::move(v.pMem, v.pMem + sz, pMem);
+            return *this;
+        }
+        release(); // Освобождаем старую память
         pMem = v.pMem;
         sz = v.sz;
+        pRes = v.pRes;
+        pRefs = v.pRefs;
         v.pMem = nullptr;
         v.sz = 0;
+        v.pRefs = nullptr;
         return *this;
     }
 
+    std::pmr::memory_resource* resource() const noexcept { return pRes; }
+
+    // Владеет ли вектор своей памятью
+    bool owns() const noexcept { return pRes != nullptr; }
+
+    // Копирование при записи: копии вектора разделяют один буфер со
+    // счетчиком ссылок, а собственный буфер получают при первом изменяющем
+    // обращении (неконстантные operator[], at, data, присваивание).
+    // Указатели и ссылки на элементы, полученные до копирования, после него
+    // могут указывать на общий буфер.
+    void setCopyOnWrite(bool on) {
+        if (on == (pRefs != nullptr))
+            return;
+        if (on) {
+            if (pRes == nullptr)
+                throw std::logic_error("Copy-on-write requires a vector that owns its memory");
+            pRefs = new std::atomic<size_t>(1);
+        } else {
+            detach();
+            delete pRefs;
+            pRefs = nullptr;
+        }
+    }
+
+    bool copyOnWrite() const noexcept { return pRefs != nullptr; }
+
+    // Разделяет ли вектор буфер с другими копиями
+    bool isShared() const noexcept {
+        return pRefs != nullptr && pRefs->load(std::memory_order_acquire) > 1;
+    }
+
+    T* data() { detach(); return pMem; }
+    const T* data() const noexcept { return pMem; }
+
     size_t size() const noexcept { return sz; }
 
     // Индексация
     T& operator[](size_t ind) {
+        detach();
         return pMem[ind];
     }
 
@@ -95,6 +330,7 @@ public:
     T& at(size_t ind) {
         if (ind >= sz)
             throw out_of_range("Index out of range");
+        detach();
         return pMem[ind];
     }
 
@@ -121,7 +357,7 @@ public:
 
     // Скалярные операции
     TDynamicVector operator+(T val) {
-        TDynamicVector res(sz);
+        TDynamicVector res(sz, result_resource());
         for (size_t i = 0; i < sz; i++) {
             res[i] = pMem[i] + val;
         }
@@ -129,7 +365,7 @@ public:
     }
 
     TDynamicVector operator-(T val) {
-        TDynamicVector res(sz);
+        TDynamicVector res(sz, result_resource());
         for (size_t i = 0; i < sz; i++) {
             res[i] = pMem[i] - val;
         }
@@ -137,7 +373,7 @@ public:
     }
 
     TDynamicVector operator*(T val) {
-        TDynamicVector res(sz);
+        TDynamicVector res(sz, result_resource());
         for (size_t i = 0; i < sz; i++) {
             res[i] = pMem[i] * val;
         }
@@ -149,7 +385,7 @@ public:
         if (sz != v.sz)
             throw std::invalid_argument("Vectors must have the same size for addition");
 
-        TDynamicVector res(sz);
+        TDynamicVector res(sz, result_resource());
         for (size_t i = 0; i < sz; i++) {
             res[i] = pMem[i] + v.pMem[i];
         }
@@ -160,7 +396,7 @@ public:
         if (sz != v.sz)
             throw std::invalid_argument("Vectors must have the same size for subtraction");
 
-        TDynamicVector res(sz);
+        TDynamicVector res(sz, result_resource());
         for (size_t i = 0; i < sz; i++) {
             res[i] = pMem[i] - v.pMem[i];
         }
@@ -179,21 +415,140 @@ public:
     }
 
     // Ввод/вывод
+    // Числа читаются быстрым путем readTextNumbers, остальные типы - operator>>
     friend istream& operator>>(istream& istr, TDynamicVector& v) {
-        for (size_t i = 0; i < v.sz; i++) {
-            istr >> v.pMem[i];
-        }
-        return istr;
+        v.detach();
+        return readTextNumbers(istr, v.pMem, v.sz);
     }
 
     friend ostream& operator<<(ostream& ostr, const TDynamicVector& v) {
-        for (size_t i = 0; i < v.sz; i++) {
-            ostr << v.pMem[i] << " ";
+        TTextWriter w(ostr, TTextWriter::capacityFor(v.sz));
+        writeTextNumbers(w, v.pMem, v.sz);
+        w.flush();
+        return ostr;
+    }
+};
+
+// Срез по строкам матрицы с шагом: элемент i -
+// rows[r0 + i * rowStep][c0 + i * colStep]. Столбец - colStep == 0,
+// диагональ - rowStep == colStep == 1. Не владеет памятью и не копирует ее;
+// запись через срез меняет исходную матрицу.
+template<typename T>
+class TStridedView {
+    TDynamicVector<T>* pRows;
+    size_t n;
+    size_t r0, c0;
+    size_t rowStep;
+    ptrdiff_t colStep;
+public:
+    TStridedView(TDynamicVector<T>* rows, size_t count, size_t row0, size_t col0,
+                 size_t rStep = 1, ptrdiff_t cStep = 0)
+        : pRows(rows), n(count), r0(row0), c0(col0), rowStep(rStep), colStep(cStep) {}
+
+    size_t size() const noexcept { return n; }
+
+    // Идут ли элементы подряд в памяти (срез по одной строке)
+    bool contiguous() const noexcept { return n <= 1 || (rowStep == 0 && colStep == 1); }
+
+    T& operator[](size_t ind) const {
+        return pRows[r0 + ind * rowStep][c0 + ptrdiff_t(ind) * colStep];
+    }
+
+    T& at(size_t ind) const {
+        if (ind >= n)
+            throw out_of_range("Index out of range");
+        return (*this)[ind];
+    }
+
+    // Копия значений в обычный вектор
+    TDynamicVector<T> copy() const {
+        TDynamicVector<T> res(n);
+        for (size_t i = 0; i < n; i++)
+            res[i] = (*this)[i];
+        return res;
+    }
+
+    friend ostream& operator<<(ostream& ostr, const TStridedView& v) {
+        TTextWriter w(ostr, TTextWriter::capacityFor(v.n));
+        for (size_t i = 0; i < v.n; i++) {
+            w.number(v[i]);
+            w.put(' ');
         }
+        w.flush();
         return ostr;
     }
 };
 
+// Прямоугольное окно матрицы rows x cols с левым верхним углом (r0, c0).
+// Не владеет памятью и не копирует ее: строки окна - части строк исходной
+// матрицы. Окно годится для gemm, gemv и add; матрица должна его пережить.
+template<typename T>
+class TMatrixView {
+    TDynamicVector<T>* pRows;
+    size_t r0, c0;
+    size_t nRows, nCols;
+public:
+    TMatrixView(TDynamicVector<T>* rows, size_t row0, size_t col0, size_t numRows, size_t numCols)
+        : pRows(rows), r0(row0), c0(col0), nRows(numRows), nCols(numCols) {
+        if (nRows == 0 || nCols == 0)
+            throw out_of_range("View size should be greater than zero");
+    }
+
+    size_t rows() const noexcept { return nRows; }
+    size_t cols() const noexcept { return nCols; }
+
+    T& operator()(size_t i, size_t j) const { return pRows[r0 + i][c0 + j]; }
+
+    // Начало строки i окна
+    T* row(size_t i) const { return &pRows[r0 + i][c0]; }
+
+    // Строка окна как вектор над памятью матрицы
+    TDynamicVector<T> operator[](size_t i) const {
+        return TDynamicVector<T>(row(i), nCols, adopt);
+    }
+
+    TMatrixView submatrix(size_t row0, size_t col0, size_t numRows, size_t numCols) const {
+        if (row0 + numRows > nRows || col0 + numCols > nCols)
+            throw out_of_range("Submatrix exceeds matrix bounds");
+        return TMatrixView(pRows, r0 + row0, c0 + col0, numRows, numCols);
+    }
+
+    TMatrixView rowRange(size_t row0, size_t numRows) const {
+        return submatrix(row0, 0, numRows, nCols);
+    }
+
+    TStridedView<T> column(size_t j, size_t rowStep = 1) const {
+        if (j >= nCols || rowStep == 0)
+            throw out_of_range("Column index out of range");
+        return TStridedView<T>(pRows, (nRows + rowStep - 1) / rowStep, r0, c0 + j, rowStep, 0);
+    }
+
+    TStridedView<T> diagonal() const {
+        return TStridedView<T>(pRows, std::min(nRows, nCols), r0, c0, 1, 1);
+    }
+
+    // Пересекаются ли окна одной и той же матрицы
+    bool overlaps(const TMatrixView& v) const noexcept {
+        return pRows == v.pRows &&
+               r0 < v.r0 + v.nRows && v.r0 < r0 + nRows &&
+               c0 < v.c0 + v.nCols && v.c0 < c0 + nCols;
+    }
+
+    bool sameWindow(const TMatrixView& v) const noexcept {
+        return pRows == v.pRows && r0 == v.r0 && c0 == v.c0 && nRows == v.nRows && nCols == v.nCols;
+    }
+
+    friend ostream& operator<<(ostream& ostr, const TMatrixView& m) {
+        TTextWriter w(ostr, TTextWriter::capacityFor(m.nRows * m.nCols));
+        for (size_t i = 0; i < m.nRows; i++) {
+            writeTextNumbers(w, m.row(i), m.nCols);
+            w.put('\n');
+        }
+        w.flush();
+        return ostr.flush();
+    }
+};
+
 // Динамическая матрица - 
 // шаблонная матрица на динамической памяти
 template<typename T>
@@ -204,17 +559,102 @@ class TDynamicMatrix : private TDynamicVector<TDynamicVector<T>> {
 public:
     using TDynamicVector<TDynamicVector<T>>::operator[];
     using TDynamicVector<TDynamicVector<T>>::at; 
-    TDynamicMatrix(size_t s = 1) : TDynamicVector<TDynamicVector<T>>(s) {
+    using TDynamicVector<TDynamicVector<T>>::resource;
+    using TDynamicVector<TDynamicVector<T>>::copyOnWrite;
+    using TDynamicVector<TDynamicVector<T>>::isShared;
+    TDynamicMatrix(size_t s = 1, std::pmr::memory_resource* r = currentMemoryResource())
+        : TDynamicVector<TDynamicVector<T>>(s, r) {
+        if (s > MAX_MATRIX_SIZE)
+            throw std::out_of_range("Matrix size exceeds MAX_MATRIX_SIZE");
+
+        for (size_t i = 0; i < this->sz; i++) {
+            this->pMem[i] = TDynamicVector<T>(s, r);
+        }
+    }
+
+    // Создание с размещением строк по узлам NUMA: память строк выделяется
+    // из r в вызывающем потоке (источник может быть не потокобезопасным), а
+    // обнуляется - и тем самым впервые касается страниц - тот поток пула,
+    // который выбран политикой. Кэш буферов для строк не используется: его
+    // буферы уже тронуты, строки берутся прямо из кучи.
+    TDynamicMatrix(size_t s, const TPlacement& placement, TThreadPool& pool = TThreadPool::global(),
+                   std::pmr::memory_resource* res = currentMemoryResource())
+        : TDynamicVector<TDynamicVector<T>>(s, res) {
+        if (s > MAX_MATRIX_SIZE)
+            throw std::out_of_range("Matrix size exceeds MAX_MATRIX_SIZE");
+
+        std::pmr::memory_resource* r = placementMemoryResource(res);
+        std::vector<T*> rows(s, nullptr);
+        std::vector<char> built(s, 0);
+        try {
+            for (size_t i = 0; i < s; i++)
+                rows[i] = static_cast<T*>(r->allocate(s * sizeof(T), alignof(T)));
+            pool.forEachPlaced(s, placement, [&](size_t i) {
+                std::uninitialized_value_construct_n(rows[i], s);
+                built[i] = 1;
+            });
+        } catch (...) {
+            for (size_t i = 0; i < s && rows[i] != nullptr; i++) {
+                if (built[i])
+                    std::destroy_n(rows[i], s);
+                r->deallocate(rows[i], s * sizeof(T), alignof(T));
+            }
+            throw;
+        }
+        for (size_t i = 0; i < s; i++)
+            this->pMem[i] = TDynamicVector<T>(rows[i], s, r, adopt);
+    }
+
+    // Матрица над внешним массивом s x s, хранящимся по строкам, без копирования:
+    // строки работают прямо с data, собственная память нужна только под
+    // массив заголовков строк
+    TDynamicMatrix(T* data, size_t s, TAdopt) : TDynamicVector<TDynamicVector<T>>(s) {
         if (s > MAX_MATRIX_SIZE)
             throw std::out_of_range("Matrix size exceeds MAX_MATRIX_SIZE");
 
         for (size_t i = 0; i < this->sz; i++) {
-            this->pMem[i] = TDynamicVector<T>(s);
+            this->pMem[i] = TDynamicVector<T>(data + i * s, s, adopt);
         }
     }
 
+    // Копия в заданный источник памяти (и сама матрица, и ее строки)
+    TDynamicMatrix(const TDynamicMatrix& m, std::pmr::memory_resource* r)
+        : TDynamicVector<TDynamicVector<T>>(m, r) {}
+
     size_t size() const noexcept { return sz; }
 
+    // Копирование при записи для матрицы: копии разделяют массив строк, а
+    // строки - свои буферы. Первое изменение копирует массив заголовков
+    // строк (O(n)) и только ту строку, которая меняется.
+    void setCopyOnWrite(bool on) {
+        TDynamicVector<TDynamicVector<T>>::setCopyOnWrite(on);
+        for (size_t i = 0; i < sz; i++) {
+            pMem[i].setCopyOnWrite(on);
+        }
+    }
+
+    // Окна и срезы без копирования
+    TMatrixView<T> view() {
+        this->detach();
+        return TMatrixView<T>(pMem, 0, 0, sz, sz);
+    }
+
+    TMatrixView<T> submatrix(size_t r0, size_t c0, size_t rows, size_t cols) {
+        return view().submatrix(r0, c0, rows, cols);
+    }
+
+    TMatrixView<T> rowRange(size_t r0, size_t rows) {
+        return view().rowRange(r0, rows);
+    }
+
+    TStridedView<T> column(size_t j, size_t rowStep = 1) {
+        return view().column(j, rowStep);
+    }
+
+    TStridedView<T> diagonal() {
+        return view().diagonal();
+    }
+
     // Сравнение
     bool operator==(const TDynamicMatrix& m) const noexcept {
         if (sz != m.sz)
@@ -232,7 +672,7 @@ public:
 
     // Матрично-скалярные операции
     TDynamicMatrix operator*(const T& val) {
-        TDynamicMatrix res(sz);
+        TDynamicMatrix res(sz, this->result_resource());
         for (size_t i = 0; i < sz; i++) {
             res[i] = pMem[i] * val;
         }
@@ -244,10 +684,18 @@ public:
         if (sz != v.size())
             throw std::invalid_argument("Matrix size and vector size must match for multiplication");
 
-        TDynamicVector<T> res(sz);
-        for (size_t i = 0; i < sz; i++) {
-            res[i] = pMem[i] * v;
+        TDynamicVector<T> res(sz, this->result_resource());
+        gemv(T(1), *this, v, T(), res);
+        return res;
+    }
+
+    // Умножение на пакет из k векторов: матрица читается один раз на весь пакет
+    TDynamicVector<TDynamicVector<T>> operator*(const TDynamicVector<TDynamicVector<T>>& xs) {
+        TDynamicVector<TDynamicVector<T>> res(xs.size(), this->result_resource());
+        for (size_t r = 0; r < xs.size(); r++) {
+            res[r] = TDynamicVector<T>(sz, this->result_resource());
         }
+        gemv_batch(T(1), *this, xs, T(), res);
         return res;
     }
 
@@ -257,7 +705,7 @@ public:
       if (sz != m.sz)
           throw std::invalid_argument("Matrix sizes must match for addition");
 
-      TDynamicMatrix res(sz);
+      TDynamicMatrix res(sz, this->result_resource());
       for (size_t i = 0; i < sz; i++) {
           res[i] = pMem[i] + m[i];
       }
@@ -268,7 +716,7 @@ public:
       if (sz != m.sz)
           throw std::invalid_argument("Matrix sizes must match for subtraction");
 
-      TDynamicMatrix res(sz);
+      TDynamicMatrix res(sz, this->result_resource());
       for (size_t i = 0; i < sz; i++) {
           res[i] = pMem[i] - m[i];
       }
@@ -279,33 +727,402 @@ public:
       if (sz != m.sz)
           throw std::invalid_argument("Matrix sizes must match for multiplication");
 
-      TDynamicMatrix res(sz);
-      for (size_t i = 0; i < sz; i++) {
-          for (size_t j = 0; j < sz; j++) {
-              res[i][j] = T();
-              for (size_t k = 0; k < sz; k++) {
-                  res[i][j] += pMem[i][k] * m[k][j];
-              }
-          }
-      }
+      TDynamicMatrix res(sz, this->result_resource());
+      gemm(T(1), *this, m, T(), res);
       return res;
   }
 
   // ввод/вывод
   friend istream& operator>>(istream& istr, TDynamicMatrix& m) {
+      m.detach();
       for (size_t i = 0; i < m.sz; i++) {
           istr >> m.pMem[i]; // Ввод каждой строки матрицы
       }
       return istr;
   }
 
+  // Вывод тем же форматом, что и построчный ostr << m[i] << std::endl, но
+  // через общий буфер и с одним сбросом потока в конце
   friend ostream& operator<<(ostream& ostr, const TDynamicMatrix& m) {
+      TTextWriter w(ostr, TTextWriter::capacityFor(m.sz * m.sz));
       for (size_t i = 0; i < m.sz; i++) {
-          ostr << m.pMem[i] << std::endl; // Вывод каждой строки матрицы
+          writeTextNumbers(w, std::as_const(m.pMem[i]).data(), m.sz); // Вывод каждой строки матрицы
+          w.put('\n');
       }
-      return ostr;
+      w.flush();
+      return ostr.flush();
   }
 
 };
 
+// BLAS-подобные операции с накоплением в память вызывающего:
+// результат пишется прямо в y (C), без временных объектов.
+// Как и в BLAS, при beta == 0 прежнее содержимое y (C) не читается,
+// а при alpha == 0 не читаются сомножители.
+
+// Строки [lo, hi) произведения y = alpha * A * x + beta * y; y - буфер
+// вектора, полученный через data() в вызывающем потоке, поэтому потоки,
+// пишущие в разные строки, не отделяют разделяемый буфер одновременно
+template<typename T>
+void gemv_rows(const T& alpha, const TDynamicMatrix<T>& A, const TDynamicVector<T>& x,
+               const T& beta, T* y, size_t lo, size_t hi) {
+    const size_t n = A.size();
+    if (alpha == T()) {
+        for (size_t i = lo; i < hi; i++)
+            y[i] = beta == T() ? T() : beta * y[i];
+        return;
+    }
+    for (size_t i = lo; i < hi; i++) {
+        const TDynamicVector<T>& a = A[i];
+        T sum = T();
+        for (size_t j = 0; j < n; j++) {
+            sum += a[j] * x[j];
+        }
+        if (beta == T())
+            y[i] = alpha * sum;
+        else
+            y[i] = alpha * sum + beta * y[i];
+    }
+}
+
+template<typename T>
+void check_gemv_args(const TDynamicMatrix<T>& A, const TDynamicVector<T>& x, const TDynamicVector<T>& y) {
+    const size_t n = A.size();
+    if (x.size() != n || y.size() != n)
+        throw std::invalid_argument("Matrix size and vector sizes must match for gemv");
+    if (&x == &y)
+        throw std::invalid_argument("gemv output vector must not alias the input vector");
+}
+
+// Ядра для малых размеров: размер N известен на этапе компиляции,
+// поэтому циклы по столбцам развернуты полностью.
+// Выбор ядра по размеру матрицы - через таблицы small_gemv_table/small_gemm_table.
+template<typename T, size_t N>
+void small_gemv_kernel(const T& alpha, const TDynamicMatrix<T>& A, const TDynamicVector<T>& x,
+                       const T& beta, TDynamicVector<T>& y) {
+    T xs[N];
+    static_for<N>([&](auto j) { xs[j] = x[j]; });
+    for (size_t i = 0; i < N; i++) {
+        const T* a = &A[i][0];
+        T sum = T();
+        static_for<N>([&](auto j) { sum += a[j] * xs[j]; });
+        if (beta == T())
+            y[i] = alpha * sum;
+        else
+            y[i] = alpha * sum + beta * y[i];
+    }
+}
+
+template<typename T, size_t N>
+void small_gemm_kernel(const T& alpha, const TDynamicMatrix<T>& A, const TDynamicMatrix<T>& B,
+                       const T& beta, TDynamicMatrix<T>& C) {
+    const T* b[N];
+    static_for<N>([&](auto k) { b[k] = &B[k][0]; });
+    for (size_t i = 0; i < N; i++) {
+        const T* a = &A[i][0];
+        T* c = &C[i][0];
+        T acc[N] = {};
+        static_for<N>([&](auto k) {
+            const T aik = a[k];
+            static_for<N>([&](auto j) { acc[j] += aik * b[k][j]; });
+        });
+        if (beta == T())
+            static_for<N>([&](auto j) { c[j] = alpha * acc[j]; });
+        else
+            static_for<N>([&](auto j) { c[j] = alpha * acc[j] + beta * c[j]; });
+    }
+}
+
+template<typename T>
+using TSmallGemvKernel = void (*)(const T&, const TDynamicMatrix<T>&, const TDynamicVector<T>&,
+                                  const T&, TDynamicVector<T>&);
+
+template<typename T>
+using TSmallGemmKernel = void (*)(const T&, const TDynamicMatrix<T>&, const TDynamicMatrix<T>&,
+                                  const T&, TDynamicMatrix<T>&);
+
+// Таблица ядер: элемент n - 1 обрабатывает матрицы размера n
+template<typename T, size_t... I>
+const TSmallGemvKernel<T>* small_gemv_table(std::index_sequence<I...>) {
+    static const TSmallGemvKernel<T> table[] = { &small_gemv_kernel<T, I + 1>... };
+    return table;
+}
+
+template<typename T, size_t... I>
+const TSmallGemmKernel<T>* small_gemm_table(std::index_sequence<I...>) {
+    static const TSmallGemmKernel<T> table[] = { &small_gemm_kernel<T, I + 1>... };
+    return table;
+}
+
+template<typename T>
+const TSmallGemvKernel<T>* small_gemv_table() {
+    return small_gemv_table<T>(std::make_index_sequence<TMATRIX_SMALL_KERNEL_MAX>());
+}
+
+template<typename T>
+const TSmallGemmKernel<T>* small_gemm_table() {
+    return small_gemm_table<T>(std::make_index_sequence<TMATRIX_SMALL_KERNEL_MAX>());
+}
+
+// y = alpha * A * x + beta * y
+template<typename T>
+void gemv(const T& alpha, const TDynamicMatrix<T>& A, const TDynamicVector<T>& x,
+          const T& beta, TDynamicVector<T>& y) {
+    check_gemv_args(A, x, y);
+    if (A.size() <= TMATRIX_SMALL_KERNEL_MAX && alpha != T()) {
+        small_gemv_table<T>()[A.size() - 1](alpha, A, x, beta, y);
+        return;
+    }
+    gemv_rows(alpha, A, x, beta, y.data(), 0, A.size());
+}
+
+// Параллельный вариант: строки делятся между потоками пула статически,
+// поток w обрабатывает ту же часть строк, что и при инициализации матрицы
+// через этот пул, то есть память своего узла NUMA
+template<typename T>
+void gemv(TThreadPool& pool, const T& alpha, const TDynamicMatrix<T>& A, const TDynamicVector<T>& x,
+          const T& beta, TDynamicVector<T>& y) {
+    check_gemv_args(A, x, y);
+    T* py = y.data();
+    pool.parallelFor(0, A.size(), [&](size_t lo, size_t hi, size_t) {
+        gemv_rows(alpha, A, x, beta, py, lo, hi);
+    });
+}
+
+// ys[r] = alpha * A * xs[r] + beta * ys[r] для всех r одновременно.
+// Столбцы A обрабатываются полосами, а соответствующие части векторов
+// пакета перепаковываются так, чтобы они оставались в кэше, пока полоса
+// проходится по всем строкам. Каждый элемент A загружается один раз на
+// весь пакет, а не по разу на каждый вектор.
+template<typename T>
+void gemv_batch(const T& alpha, const TDynamicMatrix<T>& A, const TDynamicVector<TDynamicVector<T>>& xs,
+                const T& beta, TDynamicVector<TDynamicVector<T>>& ys) {
+    const size_t n = A.size();
+    const size_t k = xs.size();
+    if (ys.size() != k)
+        throw std::invalid_argument("Batches must have the same number of vectors for gemv_batch");
+    if (&xs == &ys)
+        throw std::invalid_argument("gemv_batch output batch must not alias the input batch");
+    for (size_t r = 0; r < k; r++) {
+        if (xs[r].size() != n || ys[r].size() != n)
+            throw std::invalid_argument("Matrix size and vector sizes must match for gemv_batch");
+    }
+
+    // Буферы результатов отделяются один раз, а не при каждой записи
+    std::vector<T*> py(k);
+    for (size_t r = 0; r < k; r++) {
+        T* y = py[r] = ys[r].data();
+        if (beta == T()) {
+            std::fill_n(y, n, T());
+        } else if (beta != T(1)) {
+            for (size_t i = 0; i < n; i++)
+                y[i] *= beta;
+        }
+    }
+    if (alpha == T())
+        return;
+
+    // Полоса столбцов подбирается так, чтобы упакованная часть пакета
+    // (jb x k элементов) занимала порядка 256 КБ
+    const size_t packElems = std::max<size_t>(1, (256 * 1024) / sizeof(T));
+    const size_t jb = std::min(n, std::max<size_t>(1, packElems / k));
+    const size_t group = 8;
+    TDynamicVector<T> pack(jb * k);
+
+    for (size_t j0 = 0; j0 < n; j0 += jb) {
+        const size_t jn = std::min(jb, n - j0);
+        // pack[j * k + r] = xs[r][j0 + j]
+        for (size_t r = 0; r < k; r++) {
+            const TDynamicVector<T>& x = xs[r];
+            for (size_t j = 0; j < jn; j++)
+                pack[j * k + r] = x[j0 + j];
+        }
+        for (size_t i = 0; i < n; i++) {
+            const T* a = &A[i][j0];
+            for (size_t r0 = 0; r0 < k; r0 += group) {
+                const size_t rn = std::min(group, k - r0);
+                T acc[group] = {};
+                for (size_t j = 0; j < jn; j++) {
+                    const T aij = a[j];
+                    const T* p = &pack[j * k + r0];
+                    for (size_t r = 0; r < rn; r++)
+                        acc[r] += aij * p[r];
+                }
+                for (size_t r = 0; r < rn; r++)
+                    py[r0 + r][i] += alpha * acc[r];
+            }
+        }
+    }
+}
+
+// C = alpha * A * B + beta * C
+template<typename T>
+void gemm(const T& alpha, const TDynamicMatrix<T>& A, const TDynamicMatrix<T>& B,
+          const T& beta, TDynamicMatrix<T>& C) {
+    const size_t n = A.size();
+    if (B.size() != n || C.size() != n)
+        throw std::invalid_argument("Matrix sizes must match for gemm");
+    if (&C == &A || &C == &B)
+        throw std::invalid_argument("gemm output matrix must not alias an input matrix");
+
+    if (n <= TMATRIX_SMALL_KERNEL_MAX && alpha != T()) {
+        small_gemm_table<T>()[n - 1](alpha, A, B, beta, C);
+        return;
+    }
+
+    // Порядок i-k-j: строки B и C проходятся последовательно,
+    // а масштабирование C на beta совмещено с первым проходом по строке
+    for (size_t i = 0; i < n; i++) {
+        const TDynamicVector<T>& a = A[i];
+        T* c = C[i].data();
+        if (beta == T()) {
+            std::fill_n(c, n, T());
+        } else if (beta != T(1)) {
+            for (size_t j = 0; j < n; j++)
+                c[j] *= beta;
+        }
+        if (alpha == T())
+            continue;
+        for (size_t k = 0; k < n; k++) {
+            const T aik = alpha * a[k];
+            const TDynamicVector<T>& b = B[k];
+            for (size_t j = 0; j < n; j++) {
+                c[j] += aik * b[j];
+            }
+        }
+    }
+}
+
+// Операции над окнами матриц. Векторы x, y - любые объекты с size() и
+// operator[] (TDynamicVector, TStridedView).
+
+// C = alpha * A * B + beta * C, A - m x k, B - k x n, C - m x n
+template<typename T>
+void gemm(const T& alpha, const TMatrixView<T>& A, const TMatrixView<T>& B,
+          const T& beta, const TMatrixView<T>& C) {
+    const size_t m = A.rows(), k = A.cols(), n = B.cols();
+    if (B.rows() != k || C.rows() != m || C.cols() != n)
+        throw std::invalid_argument("View shapes must match for gemm");
+    if (C.overlaps(A) || C.overlaps(B))
+        throw std::invalid_argument("gemm output view must not overlap an input view");
+
+    for (size_t i = 0; i < m; i++) {
+        const T* a = A.row(i);
+        T* c = C.row(i);
+        if (beta == T()) {
+            std::fill_n(c, n, T());
+        } else if (beta != T(1)) {
+            for (size_t j = 0; j < n; j++)
+                c[j] *= beta;
+        }
+        if (alpha == T())
+            continue;
+        for (size_t p = 0; p < k; p++) {
+            const T aip = alpha * a[p];
+            const T* b = B.row(p);
+            for (size_t j = 0; j < n; j++) {
+                c[j] += aip * b[j];
+            }
+        }
+    }
+}
+
+// Идут ли элементы вектора или среза подряд в памяти
+template<typename T>
+bool contiguous_elements(const TDynamicVector<T>&) noexcept { return true; }
+
+template<typename T>
+bool contiguous_elements(const TStridedView<T>& v) noexcept { return v.contiguous(); }
+
+template<typename V>
+bool contiguous_elements(const V&) noexcept { return false; }
+
+// Есть ли у y общие элементы с x. Если хотя бы один операнд лежит подряд,
+// адреса другого сравниваются с его диапазоном без выделения памяти;
+// для двух срезов по разным строкам сравниваются отсортированные адреса.
+// Адреса y берутся через неконстантный доступ, как при записи результата
+template<typename X, typename Y>
+bool shares_elements(const X& x, Y& y) {
+    const std::less<const void*> less;
+    const size_t n = x.size(), m = y.size();
+    if (n == 0 || m == 0)
+        return false;
+    auto inside = [&](const void* p, const void* lo, const void* hi) { return !less(p, lo) && !less(hi, p); };
+    if (contiguous_elements(x)) {
+        const void* lo = &x[0];
+        const void* hi = &x[n - 1];
+        if (contiguous_elements(y))
+            return !less(&y[m - 1], lo) && !less(hi, &y[0]);
+        for (size_t i = 0; i < m; i++) {
+            if (inside(&y[i], lo, hi))
+                return true;
+        }
+        return false;
+    }
+    if (contiguous_elements(y)) {
+        const void* lo = &y[0];
+        const void* hi = &y[m - 1];
+        for (size_t j = 0; j < n; j++) {
+            if (inside(&x[j], lo, hi))
+                return true;
+        }
+        return false;
+    }
+    std::vector<const void*> xs(n);
+    for (size_t j = 0; j < n; j++)
+        xs[j] = &x[j];
+    std::sort(xs.begin(), xs.end(), less);
+    for (size_t i = 0; i < m; i++) {
+        if (std::binary_search(xs.begin(), xs.end(), static_cast<const void*>(&y[i]), less))
+            return true;
+    }
+    return false;
+}
+
+// y = alpha * A * x + beta * y, A - m x n; y не должен пересекаться с x
+template<typename T, typename X, typename Y>
+void gemv(const T& alpha, const TMatrixView<T>& A, const X& x, const T& beta, Y&& y) {
+    const size_t m = A.rows(), n = A.cols();
+    if (x.size() != n || y.size() != m)
+        throw std::invalid_argument("View shape and vector sizes must match for gemv");
+    if (shares_elements(x, y))
+        throw std::invalid_argument("gemv output vector must not overlap the input vector");
+
+    if (alpha == T()) {
+        for (size_t i = 0; i < m; i++)
+            y[i] = beta == T() ? T() : beta * y[i];
+        return;
+    }
+    for (size_t i = 0; i < m; i++) {
+        const T* a = A.row(i);
+        T sum = T();
+        for (size_t j = 0; j < n; j++) {
+            sum += a[j] * x[j];
+        }
+        if (beta == T())
+            y[i] = alpha * sum;
+        else
+            y[i] = alpha * sum + beta * y[i];
+    }
+}
+
+// C = A + B поэлементно; C может совпадать с A или B, но не пересекаться частично
+template<typename T>
+void add(const TMatrixView<T>& A, const TMatrixView<T>& B, const TMatrixView<T>& C) {
+    const size_t m = A.rows(), n = A.cols();
+    if (B.rows() != m || B.cols() != n || C.rows() != m || C.cols() != n)
+        throw std::invalid_argument("View shapes must match for addition");
+    if ((C.overlaps(A) && !C.sameWindow(A)) || (C.overlaps(B) && !C.sameWindow(B)))
+        throw std::invalid_argument("Addition output view must not partially overlap an input view");
+
+    for (size_t i = 0; i < m; i++) {
+        const T* a = A.row(i);
+        const T* b = B.row(i);
+        T* c = C.row(i);
+        for (size_t j = 0; j < n; j++) {
+            c[j] = a[j] + b[j];
+        }
+    }
+}
+
 #endif
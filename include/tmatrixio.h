@@ -0,0 +1,551 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Двоичный формат векторов и матриц, загрузка через отображение файла в память,
+// параллельный разбор больших текстовых файлов
+
+#ifndef __TMatrixIO_H__
+#define __TMatrixIO_H__
+
+#include "tmatrix.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// Заголовок двоичного файла (64 байта). За ним, с выравниванием dataOffset,
+// лежат элементы подряд по строкам в порядке байтов машины, записавшей файл.
+struct TBinaryHeader {
+    char magic[8];          // "TMATRIX"
+    uint32_t version;       // Версия формата
+    uint32_t byteOrder;     // 0x01020304 в порядке байтов записавшей машины
+    uint8_t kind;           // 'i' - знаковое целое, 'u' - беззнаковое, 'f' - вещественное
+    uint8_t elemSize;       // sizeof элемента
+    uint8_t rank;           // 1 - вектор, 2 - матрица
+    uint8_t layout;         // 0 - плотное хранение по строкам, 1 - по плиткам, 2 - сжатые плитки
+    uint32_t tile;          // Сторона плитки при layout != 0, иначе 0
+    uint64_t rows;
+    uint64_t cols;
+    uint64_t dataOffset;    // Смещение данных от начала файла
+    uint8_t pad[16];
+
+    static constexpr uint32_t currentVersion = 1;
+    static constexpr uint32_t byteOrderMark = 0x01020304;
+    static constexpr uint64_t dataAlignment = 64;
+};
+
+static_assert(sizeof(TBinaryHeader) == TBinaryHeader::dataAlignment, "Binary header must occupy exactly 64 bytes");
+
+// Код типа элемента в заголовке
+template<typename T>
+struct TBinaryElement {
+    static_assert(std::is_arithmetic<T>::value, "Binary format supports arithmetic element types only");
+
+    static constexpr uint8_t kind = std::is_floating_point<T>::value ? 'f' : std::is_signed<T>::value ? 'i' : 'u';
+    static constexpr uint8_t size = sizeof(T);
+};
+
+template<typename T>
+TBinaryHeader makeBinaryHeader(uint8_t rank, uint64_t rows, uint64_t cols) {
+    TBinaryHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, "TMATRIX", 8);
+    h.version = TBinaryHeader::currentVersion;
+    h.byteOrder = TBinaryHeader::byteOrderMark;
+    h.kind = TBinaryElement<T>::kind;
+    h.elemSize = TBinaryElement<T>::size;
+    h.rank = rank;
+    h.rows = rows;
+    h.cols = cols;
+    h.dataOffset = sizeof(TBinaryHeader);
+    return h;
+}
+
+// Проверка заголовка на совместимость с T и рангом; fileSize == 0 - размер неизвестен
+template<typename T>
+void checkBinaryHeader(const TBinaryHeader& h, uint8_t rank, uint64_t fileSize = 0) {
+    if (std::memcmp(h.magic, "TMATRIX", 8) != 0)
+        throw std::runtime_error("Not a binary matrix file");
+    if (h.version != TBinaryHeader::currentVersion)
+        throw std::runtime_error("Unsupported binary matrix format version");
+    if (h.byteOrder != TBinaryHeader::byteOrderMark)
+        throw std::runtime_error("Binary matrix file has foreign byte order");
+    if (h.kind != TBinaryElement<T>::kind || h.elemSize != TBinaryElement<T>::size)
+        throw std::runtime_error("Binary matrix file element type does not match");
+    if (h.rank != rank || h.layout != 0)
+        throw std::runtime_error("Binary matrix file shape does not match");
+    if (rank == 1 && h.rows != 1)
+        throw std::runtime_error("Binary vector file must have one row");
+    if (rank == 2 && h.rows != h.cols)
+        throw std::runtime_error("Binary matrix file must hold a square matrix");
+    if (h.dataOffset < sizeof(TBinaryHeader) || h.dataOffset % alignof(T) != 0)
+        throw std::runtime_error("Binary matrix file has invalid data offset");
+    if (h.cols > MAX_VECTOR_SIZE)
+        throw std::out_of_range("Binary matrix file exceeds size limits");
+    if (fileSize != 0 && (fileSize < h.dataOffset || fileSize - h.dataOffset < h.rows * h.cols * sizeof(T)))
+        throw std::runtime_error("Binary matrix file is truncated");
+}
+
+// Запись в поток, открытый в двоичном режиме
+template<typename T>
+void writeBinary(ostream& ostr, const TDynamicVector<T>& v) {
+    TBinaryHeader h = makeBinaryHeader<T>(1, 1, v.size());
+    ostr.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    ostr.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+    if (!ostr)
+        throw std::runtime_error("Failed to write binary vector");
+}
+
+template<typename T>
+void writeBinary(ostream& ostr, const TDynamicMatrix<T>& m) {
+    TBinaryHeader h = makeBinaryHeader<T>(2, m.size(), m.size());
+    ostr.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    for (size_t i = 0; i < m.size(); i++) {
+        ostr.write(reinterpret_cast<const char*>(m[i].data()), m.size() * sizeof(T));
+    }
+    if (!ostr)
+        throw std::runtime_error("Failed to write binary matrix");
+}
+
+// Чтение из потока, открытого в двоичном режиме
+template<typename T>
+TBinaryHeader readBinaryHeader(istream& istr, uint8_t rank) {
+    TBinaryHeader h;
+    if (!istr.read(reinterpret_cast<char*>(&h), sizeof(h)))
+        throw std::runtime_error("Failed to read binary matrix header");
+    checkBinaryHeader<T>(h, rank);
+    istr.ignore(std::streamsize(h.dataOffset - sizeof(h)));
+    return h;
+}
+
+template<typename T>
+TDynamicVector<T> readBinaryVector(istream& istr) {
+    TBinaryHeader h = readBinaryHeader<T>(istr, 1);
+    TDynamicVector<T> v(size_t(h.cols));
+    if (!istr.read(reinterpret_cast<char*>(v.data()), v.size() * sizeof(T)))
+        throw std::runtime_error("Binary vector data is truncated");
+    return v;
+}
+
+template<typename T>
+TDynamicMatrix<T> readBinaryMatrix(istream& istr) {
+    TBinaryHeader h = readBinaryHeader<T>(istr, 2);
+    TDynamicMatrix<T> m(size_t(h.rows));
+    for (size_t i = 0; i < m.size(); i++) {
+        if (!istr.read(reinterpret_cast<char*>(m[i].data()), m.size() * sizeof(T)))
+            throw std::runtime_error("Binary matrix data is truncated");
+    }
+    return m;
+}
+
+// Сохранение и загрузка по имени файла
+template<typename T>
+void saveBinary(const std::string& path, const TDynamicVector<T>& v) {
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    if (!f)
+        throw std::runtime_error("Cannot open file for writing: " + path);
+    writeBinary(f, v);
+}
+
+template<typename T>
+void saveBinary(const std::string& path, const TDynamicMatrix<T>& m) {
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    if (!f)
+        throw std::runtime_error("Cannot open file for writing: " + path);
+    writeBinary(f, m);
+}
+
+template<typename T>
+TDynamicVector<T> loadBinaryVector(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f)
+        throw std::runtime_error("Cannot open file for reading: " + path);
+    return readBinaryVector<T>(f);
+}
+
+template<typename T>
+TDynamicMatrix<T> loadBinaryMatrix(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f)
+        throw std::runtime_error("Cannot open file for reading: " + path);
+    return readBinaryMatrix<T>(f);
+}
+
+// Файл с чтением и записью по смещению (pread/pwrite), без общей позиции
+class TFile {
+#if defined(_WIN32)
+    HANDLE h = INVALID_HANDLE_VALUE;
+#else
+    int fd = -1;
+#endif
+
+public:
+    enum TMode { Read, ReadWrite, Create };
+
+    TFile(const std::string& path, TMode mode) {
+#if defined(_WIN32)
+        h = CreateFileA(path.c_str(), GENERIC_READ | (mode == Read ? 0 : GENERIC_WRITE), FILE_SHARE_READ,
+                        nullptr, mode == Create ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (h == INVALID_HANDLE_VALUE)
+            throw std::runtime_error("Cannot open file: " + path);
+#else
+        fd = open(path.c_str(), mode == Read ? O_RDONLY : mode == ReadWrite ? O_RDWR : O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            throw std::runtime_error("Cannot open file: " + path);
+#endif
+    }
+
+    TFile(const TFile&) = delete;
+    TFile& operator=(const TFile&) = delete;
+
+    ~TFile() {
+#if defined(_WIN32)
+        CloseHandle(h);
+#else
+        close(fd);
+#endif
+    }
+
+#if defined(_WIN32)
+    HANDLE handle() const noexcept { return h; }
+#else
+    int handle() const noexcept { return fd; }
+#endif
+
+    void readAt(uint64_t offset, void* p, size_t n) const {
+        char* dst = static_cast<char*>(p);
+        while (n != 0) {
+#if defined(_WIN32)
+            OVERLAPPED ov = {};
+            ov.Offset = DWORD(offset);
+            ov.OffsetHigh = DWORD(offset >> 32);
+            DWORD got = 0;
+            DWORD want = DWORD(std::min<size_t>(n, 1u << 30));
+            if (!ReadFile(h, dst, want, &got, &ov) || got == 0)
+                throw std::runtime_error("File read failed");
+#else
+            ssize_t got = pread(fd, dst, n, off_t(offset));
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got <= 0)
+                throw std::runtime_error("File read failed");
+#endif
+            dst += got;
+            offset += uint64_t(got);
+            n -= size_t(got);
+        }
+    }
+
+    void writeAt(uint64_t offset, const void* p, size_t n) {
+        const char* src = static_cast<const char*>(p);
+        while (n != 0) {
+#if defined(_WIN32)
+            OVERLAPPED ov = {};
+            ov.Offset = DWORD(offset);
+            ov.OffsetHigh = DWORD(offset >> 32);
+            DWORD put = 0;
+            DWORD want = DWORD(std::min<size_t>(n, 1u << 30));
+            if (!WriteFile(h, src, want, &put, &ov) || put == 0)
+                throw std::runtime_error("File write failed");
+#else
+            ssize_t put = pwrite(fd, src, n, off_t(offset));
+            if (put < 0 && errno == EINTR)
+                continue;
+            if (put <= 0)
+                throw std::runtime_error("File write failed");
+#endif
+            src += put;
+            offset += uint64_t(put);
+            n -= size_t(put);
+        }
+    }
+
+    // Новая длина файла; добавленная часть читается нулями
+    void resize(uint64_t size) {
+#if defined(_WIN32)
+        LARGE_INTEGER pos;
+        pos.QuadPart = LONGLONG(size);
+        if (!SetFilePointerEx(h, pos, nullptr, FILE_BEGIN) || !SetEndOfFile(h))
+            throw std::runtime_error("File resize failed");
+#else
+        if (ftruncate(fd, off_t(size)) != 0)
+            throw std::runtime_error("File resize failed");
+#endif
+    }
+
+    uint64_t size() const {
+#if defined(_WIN32)
+        LARGE_INTEGER sz;
+        if (!GetFileSizeEx(h, &sz))
+            throw std::runtime_error("Cannot query file size");
+        return uint64_t(sz.QuadPart);
+#else
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+            throw std::runtime_error("Cannot query file size");
+        return uint64_t(st.st_size);
+#endif
+    }
+};
+
+// Файл, целиком отображенный в память.
+// writable == false - изменения остаются в памяти процесса (копирование
+// страниц при записи), writable == true - изменения попадают в файл.
+class TMappedFile {
+    void* pData = nullptr;
+    size_t len = 0;
+#if defined(_WIN32)
+    HANDLE hFile = INVALID_HANDLE_VALUE;
+    HANDLE hMap = nullptr;
+#endif
+
+    void unmap() noexcept {
+#if defined(_WIN32)
+        if (pData != nullptr)
+            UnmapViewOfFile(pData);
+        if (hMap != nullptr)
+            CloseHandle(hMap);
+        if (hFile != INVALID_HANDLE_VALUE)
+            CloseHandle(hFile);
+        hMap = nullptr;
+        hFile = INVALID_HANDLE_VALUE;
+#else
+        if (pData != nullptr)
+            munmap(pData, len);
+#endif
+        pData = nullptr;
+        len = 0;
+    }
+
+public:
+    explicit TMappedFile(const std::string& path, bool writable = false) {
+#if defined(_WIN32)
+        hFile = CreateFileA(path.c_str(), GENERIC_READ | (writable ? GENERIC_WRITE : 0), FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE)
+            throw std::runtime_error("Cannot open file for mapping: " + path);
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(hFile, &fileSize)) {
+            unmap();
+            throw std::runtime_error("Cannot query file size: " + path);
+        }
+        len = size_t(fileSize.QuadPart);
+        if (len == 0)
+            return;
+        hMap = CreateFileMappingA(hFile, nullptr, writable ? PAGE_READWRITE : PAGE_WRITECOPY, 0, 0, nullptr);
+        if (hMap != nullptr)
+            pData = MapViewOfFile(hMap, writable ? FILE_MAP_WRITE : FILE_MAP_COPY, 0, 0, 0);
+        if (pData == nullptr) {
+            unmap();
+            throw std::runtime_error("Cannot map file: " + path);
+        }
+#else
+        int fd = open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Cannot open file for mapping: " + path);
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw std::runtime_error("Cannot query file size: " + path);
+        }
+        len = size_t(st.st_size);
+        if (len != 0) {
+            void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE, writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                close(fd);
+                len = 0;
+                throw std::runtime_error("Cannot map file: " + path);
+            }
+            pData = p;
+        }
+        close(fd); // Отображение остается действительным и после закрытия
+#endif
+    }
+
+    TMappedFile(const TMappedFile&) = delete;
+    TMappedFile& operator=(const TMappedFile&) = delete;
+
+    TMappedFile(TMappedFile&& f) noexcept : pData(f.pData), len(f.len) {
+#if defined(_WIN32)
+        hFile = f.hFile;
+        hMap = f.hMap;
+        f.hFile = INVALID_HANDLE_VALUE;
+        f.hMap = nullptr;
+#endif
+        f.pData = nullptr;
+        f.len = 0;
+    }
+
+    ~TMappedFile() {
+        unmap();
+    }
+
+    char* data() const noexcept { return static_cast<char*>(pData); }
+    size_t size() const noexcept { return len; }
+};
+
+// Проверенный заголовок отображенного файла
+template<typename T>
+TBinaryHeader mappedBinaryHeader(const TMappedFile& f, uint8_t rank) {
+    if (f.size() < sizeof(TBinaryHeader))
+        throw std::runtime_error("Binary matrix file is truncated");
+    TBinaryHeader h;
+    std::memcpy(&h, f.data(), sizeof(h));
+    checkBinaryHeader<T>(h, rank, f.size());
+    return h;
+}
+
+// Вектор и матрица, загруженные из двоичного файла без копирования: они
+// работают прямо с отображенными страницами (режим заимствования памяти),
+// поэтому загрузка не зависит от размера данных. Объект владеет
+// отображением, и вектор/матрица действительны, пока он существует.
+template<typename T>
+class TMappedVector {
+    TMappedFile file;
+    TBinaryHeader header;
+    TDynamicVector<T> v;
+
+public:
+    explicit TMappedVector(const std::string& path, bool writable = false)
+        : file(path, writable), header(mappedBinaryHeader<T>(file, 1)),
+          v(reinterpret_cast<T*>(file.data() + header.dataOffset), size_t(header.cols), adopt) {}
+
+    TDynamicVector<T>& vector() noexcept { return v; }
+    const TDynamicVector<T>& vector() const noexcept { return v; }
+};
+
+template<typename T>
+class TMappedMatrix {
+    TMappedFile file;
+    TBinaryHeader header;
+    TDynamicMatrix<T> m;
+
+public:
+    explicit TMappedMatrix(const std::string& path, bool writable = false)
+        : file(path, writable), header(mappedBinaryHeader<T>(file, 2)),
+          m(reinterpret_cast<T*>(file.data() + header.dataOffset), size_t(header.rows), adopt) {}
+
+    TDynamicMatrix<T>& matrix() noexcept { return m; }
+    const TDynamicMatrix<T>& matrix() const noexcept { return m; }
+};
+
+// Параллельный разбор текста матрицы в формате operator<<: строка матрицы
+// на строке текста, числа через пробелы, пустые строки пропускаются.
+// Текст делится на куски по границам строк; первый проход считает в каждом
+// куске строки текста и строки матрицы, второй разбирает куски в потоках
+// пула прямо в строки матрицы. Размер матрицы - число непустых строк.
+// Ошибка сообщается как TTextParseError с точной строкой и столбцом.
+template<typename T>
+TDynamicMatrix<T> parseTextMatrix(const char* first, const char* last, TThreadPool& pool = TThreadPool::global()) {
+    const size_t minChunk = size_t(1) << 16;
+    size_t chunks = std::max<size_t>(1, std::min<size_t>(pool.size() * 4, size_t(last - first) / minChunk));
+    std::vector<const char*> bounds(1, first);
+    for (size_t c = 1; c < chunks; c++) {
+        const char* p = first + size_t(last - first) * c / chunks;
+        if (p < bounds.back())
+            continue;
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', last - p));
+        if (nl == nullptr)
+            break;
+        if (nl + 1 > bounds.back() && nl + 1 < last)
+            bounds.push_back(nl + 1);
+    }
+    bounds.push_back(last);
+    chunks = bounds.size() - 1;
+
+    // Первый проход: строки текста и непустые строки в каждом куске
+    std::vector<size_t> lines(chunks + 1, 0), rows(chunks + 1, 0);
+    pool.parallelFor(0, chunks, [&](size_t lo, size_t hi, size_t) {
+        for (size_t c = lo; c < hi; c++) {
+            for (const char* p = bounds[c]; p < bounds[c + 1];) {
+                const char* nl = static_cast<const char*>(std::memchr(p, '\n', bounds[c + 1] - p));
+                const char* end = nl ? nl : bounds[c + 1];
+                if (skipTextSpace(p, end) != end)
+                    rows[c + 1]++;
+                if (nl)
+                    lines[c + 1]++;
+                p = end + 1;
+            }
+        }
+    });
+    lines[0] = 1;
+    for (size_t c = 0; c < chunks; c++) {
+        lines[c + 1] += lines[c];
+        rows[c + 1] += rows[c];
+    }
+    const size_t n = rows[chunks];
+    if (n == 0)
+        throw TTextParseError("Text matrix is empty", 1, 1);
+
+    TDynamicMatrix<T> m(n, TPlacement::firstTouch(), pool);
+    std::vector<T*> rowData(n);
+    for (size_t i = 0; i < n; i++)
+        rowData[i] = m[i].data();
+
+    // Второй проход: разбор; из ошибок сообщается первая по тексту
+    struct TChunkError { size_t line = 0, column = 0; std::string what; };
+    std::vector<TChunkError> errors(chunks);
+    pool.parallelFor(0, chunks, [&](size_t lo, size_t hi, size_t) {
+        for (size_t c = lo; c < hi; c++) {
+            size_t line = lines[c], row = rows[c];
+            auto fail = [&](const char* what, const char* lineStart, const char* at) {
+                errors[c].line = line;
+                errors[c].column = size_t(at - lineStart) + 1;
+                errors[c].what = what;
+            };
+            for (const char* p = bounds[c]; p < bounds[c + 1]; line++) {
+                const char* nl = static_cast<const char*>(std::memchr(p, '\n', bounds[c + 1] - p));
+                const char* end = nl ? nl : bounds[c + 1];
+                const char* lineStart = p;
+                p = skipTextSpace(p, end);
+                if (p != end) {
+                    T* dst = rowData[row++];
+                    size_t count = 0;
+                    while (p != end) {
+                        if (count == n)
+                            return fail("Too many values in matrix row", lineStart, p);
+                        const char* q = parseTextNumber(p, end, dst[count]);
+                        if (q == nullptr || (q != end && !isTextSpace(*q)))
+                            return fail("Invalid number", lineStart, p);
+                        count++;
+                        p = skipTextSpace(q, end);
+                    }
+                    if (count < n)
+                        return fail("Too few values in matrix row", lineStart, end);
+                }
+                p = end + 1;
+            }
+        }
+    });
+    for (const TChunkError& e : errors) {
+        if (e.line != 0)
+            throw TTextParseError(e.what, e.line, e.column);
+    }
+    return m;
+}
+
+// Загрузка текстового файла матрицы через отображение в память
+template<typename T>
+TDynamicMatrix<T> loadTextMatrix(const std::string& path, TThreadPool& pool = TThreadPool::global()) {
+    TMappedFile file(path);
+    return parseTextMatrix<T>(file.data(), file.data() + file.size(), pool);
+}
+
+#endif
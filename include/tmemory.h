@@ -0,0 +1,414 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Источники памяти для векторов и матриц: арена и пулы по классам размеров
+
+#ifndef __TMemory_H__
+#define __TMemory_H__
+
+#include <memory_resource>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+// Статистика кэша буферов текущего потока
+struct TBufferCacheStats {
+    size_t hits = 0;          // запросы, обслуженные из кэша
+    size_t misses = 0;        // запросы, переданные вышестоящему источнику
+    size_t bypasses = 0;      // запросы, слишком большие для кэша
+    size_t cachedBuffers = 0; // буферов сейчас в кэше
+    size_t cachedBytes = 0;   // их суммарный размер
+};
+
+// Кэш недавно освобожденных буферов, свой у каждого потока.
+// Размеры округляются вверх до одного из четырех шагов внутри каждой
+// степени двойки (потери не больше 25%), освобожденный буфер кладется в
+// корзину своего размера и отдается следующему запросу того же размера.
+// Так повторяющиеся временные объекты одного размера не обращаются к
+// куче. Буфер, освобожденный в другом потоке, попадает в кэш этого потока.
+// Объем кэша потока ограничен capacity(); лишние буферы возвращаются сразу.
+class TBufferCache : public std::pmr::memory_resource {
+    static constexpr size_t classCount = 160;
+    static constexpr size_t align = alignof(std::max_align_t);
+
+    enum State { Unused, Alive, Dead };
+
+    struct TLocal {
+        std::vector<void*> buckets[classCount];
+        TBufferCacheStats st;
+        size_t capacity = 64 * 1024 * 1024;
+
+        TLocal() { state() = Alive; }
+
+        ~TLocal() {
+            clear();
+            state() = Dead;
+        }
+
+        void clear() noexcept {
+            for (size_t c = 0; c < classCount; c++) {
+                for (void* p : buckets[c])
+                    std::pmr::new_delete_resource()->deallocate(p, classBytes(c), align);
+                buckets[c].clear();
+            }
+            st.cachedBuffers = 0;
+            st.cachedBytes = 0;
+        }
+    };
+
+    // Состояние кэша потока; после уничтожения кэша при завершении потока
+    // буферы освобождаются напрямую
+    static State& state() noexcept {
+        thread_local State s = Unused;
+        return s;
+    }
+
+    static TLocal& local() {
+        thread_local TLocal t;
+        return t;
+    }
+
+    // Номер класса размера; (2^e, 2^(e+1)] делится на четыре шага
+    static size_t classOf(size_t bytes) noexcept {
+        if (bytes <= 64)
+            return 0;
+        size_t e = 6;
+        while ((size_t(1) << (e + 1)) < bytes)
+            e++;
+        size_t step = size_t(1) << (e - 2);
+        size_t q = (bytes - (size_t(1) << e) + step - 1) / step;
+        return 1 + (e - 6) * 4 + (q - 1);
+    }
+
+    static size_t classBytes(size_t cls) noexcept {
+        if (cls == 0)
+            return 64;
+        size_t e = 6 + (cls - 1) / 4;
+        size_t q = (cls - 1) % 4 + 1;
+        return (size_t(1) << e) + q * (size_t(1) << (e - 2));
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t al) override {
+        // Буферы всегда выделяются размером своего класса, чтобы любой из
+        // них можно было положить в кэш при освобождении
+        size_t cls = classOf(bytes);
+        if (al > align || cls >= classCount)
+            return std::pmr::new_delete_resource()->allocate(bytes, al);
+        if (state() == Dead)
+            return std::pmr::new_delete_resource()->allocate(classBytes(cls), align);
+        TLocal& t = local();
+        if (classBytes(cls) > t.capacity) {
+            t.st.bypasses++;
+            return std::pmr::new_delete_resource()->allocate(classBytes(cls), align);
+        }
+        std::vector<void*>& b = t.buckets[cls];
+        if (!b.empty()) {
+            void* p = b.back();
+            b.pop_back();
+            t.st.hits++;
+            t.st.cachedBuffers--;
+            t.st.cachedBytes -= classBytes(cls);
+            return p;
+        }
+        t.st.misses++;
+        return std::pmr::new_delete_resource()->allocate(classBytes(cls), align);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t al) override {
+        size_t cls = classOf(bytes);
+        if (al > align || cls >= classCount) {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, al);
+            return;
+        }
+        if (state() == Dead) {
+            std::pmr::new_delete_resource()->deallocate(p, classBytes(cls), align);
+            return;
+        }
+        TLocal& t = local();
+        size_t sz = classBytes(cls);
+        if (t.st.cachedBytes + sz > t.capacity) {
+            std::pmr::new_delete_resource()->deallocate(p, sz, align);
+            return;
+        }
+        t.buckets[cls].push_back(p);
+        t.st.cachedBuffers++;
+        t.st.cachedBytes += sz;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+public:
+    static TBufferCache& instance() {
+        static TBufferCache cache;
+        return cache;
+    }
+
+    // Статистика и настройки относятся к кэшу вызывающего потока
+    static TBufferCacheStats stats() { return local().st; }
+
+    static void resetStats() {
+        TBufferCacheStats& st = local().st;
+        st.hits = st.misses = st.bypasses = 0;
+    }
+
+    // Вернуть в кучу все буферы из кэша потока
+    static void clear() { local().clear(); }
+
+    static size_t capacity() { return local().capacity; }
+
+    static void setCapacity(size_t bytes) {
+        TLocal& t = local();
+        t.capacity = bytes;
+        if (t.st.cachedBytes > bytes)
+            t.clear();
+    }
+};
+
+// Источник памяти, из которого создаваемые в текущем потоке векторы и
+// матрицы берут память, если он не указан явно. По умолчанию это кэш
+// буферов потока (или new/delete, если определен TMATRIX_NO_BUFFER_CACHE).
+inline std::pmr::memory_resource*& current_memory_resource_slot() noexcept {
+    thread_local std::pmr::memory_resource* res = nullptr;
+    return res;
+}
+
+inline std::pmr::memory_resource* currentMemoryResource() noexcept {
+    std::pmr::memory_resource* res = current_memory_resource_slot();
+    if (res)
+        return res;
+#ifdef TMATRIX_NO_BUFFER_CACHE
+    return std::pmr::new_delete_resource();
+#else
+    return &TBufferCache::instance();
+#endif
+}
+
+// Источник для памяти, которую размещает по узлам NUMA первое касание:
+// кэш буферов отдает уже тронутые (возможно, на другом узле) буферы,
+// поэтому вместо него память берется прямо из кучи
+inline std::pmr::memory_resource* placementMemoryResource(std::pmr::memory_resource* r) noexcept {
+    return r == &TBufferCache::instance() ? std::pmr::new_delete_resource() : r;
+}
+
+// Область действия источника памяти: пока объект жив, векторы и матрицы,
+// создаваемые в этом потоке без явного источника, берут память из res
+class TMemoryScope {
+    std::pmr::memory_resource* prev;
+public:
+    explicit TMemoryScope(std::pmr::memory_resource* res) : prev(current_memory_resource_slot()) {
+        current_memory_resource_slot() = res;
+    }
+
+    ~TMemoryScope() {
+        current_memory_resource_slot() = prev;
+    }
+
+    TMemoryScope(const TMemoryScope&) = delete;
+    TMemoryScope& operator=(const TMemoryScope&) = delete;
+};
+
+// Арена: память выдается сдвигом указателя внутри больших блоков,
+// освобождение отдельных объектов ничего не делает, а reset() разом
+// возвращает всю выданную память. После reset() блоки объединяются в один
+// блок суммарного размера, так что повторные запросы той же формы
+// обходятся без обращений к вышестоящему источнику.
+// Не потокобезопасна.
+class TArenaResource : public std::pmr::memory_resource {
+    struct Block {
+        char* mem;
+        size_t size;
+    };
+
+    std::pmr::memory_resource* upstream;
+    std::vector<Block> blocks;
+    size_t nextBlockSize;
+    char* cur = nullptr;
+    char* end = nullptr;
+    size_t used = 0;
+
+    void addBlock(size_t minSize) {
+        size_t size = std::max(nextBlockSize, minSize);
+        char* mem = static_cast<char*>(upstream->allocate(size, alignof(std::max_align_t)));
+        blocks.push_back({ mem, size });
+        cur = mem;
+        end = mem + size;
+        nextBlockSize = size * 2;
+    }
+
+    void freeBlocks() noexcept {
+        for (const Block& b : blocks)
+            upstream->deallocate(b.mem, b.size, alignof(std::max_align_t));
+        blocks.clear();
+        cur = end = nullptr;
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t align) override {
+        for (;;) {
+            if (cur != nullptr) {
+                uintptr_t p = (reinterpret_cast<uintptr_t>(cur) + align - 1) & ~uintptr_t(align - 1);
+                if (p + bytes <= reinterpret_cast<uintptr_t>(end)) {
+                    used += p + bytes - reinterpret_cast<uintptr_t>(cur);
+                    cur = reinterpret_cast<char*>(p + bytes);
+                    return reinterpret_cast<void*>(p);
+                }
+            }
+            addBlock(bytes + align);
+        }
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+public:
+    explicit TArenaResource(size_t initialSize = 64 * 1024,
+                            std::pmr::memory_resource* up = std::pmr::new_delete_resource())
+        : upstream(up), nextBlockSize(std::max<size_t>(initialSize, 64)) {}
+
+    TArenaResource(const TArenaResource&) = delete;
+    TArenaResource& operator=(const TArenaResource&) = delete;
+
+    ~TArenaResource() override {
+        freeBlocks();
+    }
+
+    // Вернуть всю выданную память; объекты из арены к этому моменту
+    // должны быть уничтожены
+    void reset() {
+        if (blocks.size() > 1) {
+            size_t total = 0;
+            for (const Block& b : blocks)
+                total += b.size;
+            freeBlocks();
+            nextBlockSize = total;
+            addBlock(total);
+        } else if (!blocks.empty()) {
+            cur = blocks[0].mem;
+        }
+        used = 0;
+    }
+
+    // Выдано байт с последнего reset() (с учетом выравнивания)
+    size_t bytesUsed() const noexcept { return used; }
+
+    // Байт, полученных от вышестоящего источника
+    size_t capacity() const noexcept {
+        size_t total = 0;
+        for (const Block& b : blocks)
+            total += b.size;
+        return total;
+    }
+
+    size_t blockCount() const noexcept { return blocks.size(); }
+};
+
+// Пулы по классам размеров: запросы округляются вверх до степени двойки
+// (от minClass до maxClass байт), освобожденные блоки хранятся в списке
+// своего класса и выдаются повторно. Новые блоки класса нарезаются из
+// кусков по chunkSize байт. Запросы больше maxClass или с выравниванием
+// больше max_align_t передаются вышестоящему источнику.
+// Не потокобезопасен.
+class TPoolResource : public std::pmr::memory_resource {
+    static constexpr size_t minClassLog = 4;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct Chunk {
+        void* mem;
+        size_t size;
+    };
+
+    std::pmr::memory_resource* upstream;
+    size_t maxClassLog;
+    size_t chunkSize;
+    std::vector<FreeBlock*> freeLists;
+    std::vector<Chunk> chunks;
+
+    static size_t log2ceil(size_t v) noexcept {
+        size_t res = 0;
+        while ((size_t(1) << res) < v)
+            res++;
+        return res;
+    }
+
+    size_t classOf(size_t bytes) const noexcept {
+        return std::max(log2ceil(bytes), minClassLog) - minClassLog;
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t align) override {
+        if (bytes == 0)
+            bytes = 1;
+        if (log2ceil(bytes) > maxClassLog || align > alignof(std::max_align_t))
+            return upstream->allocate(bytes, align);
+
+        size_t cls = classOf(bytes);
+        if (freeLists[cls] == nullptr) {
+            size_t blockSize = size_t(1) << (cls + minClassLog);
+            size_t count = std::max<size_t>(1, chunkSize / blockSize);
+            char* mem = static_cast<char*>(upstream->allocate(blockSize * count, alignof(std::max_align_t)));
+            chunks.push_back({ mem, blockSize * count });
+            for (size_t i = count; i-- > 0;) {
+                FreeBlock* b = reinterpret_cast<FreeBlock*>(mem + i * blockSize);
+                b->next = freeLists[cls];
+                freeLists[cls] = b;
+            }
+        }
+        FreeBlock* b = freeLists[cls];
+        freeLists[cls] = b->next;
+        return b;
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t align) override {
+        if (bytes == 0)
+            bytes = 1;
+        if (log2ceil(bytes) > maxClassLog || align > alignof(std::max_align_t)) {
+            upstream->deallocate(p, bytes, align);
+            return;
+        }
+        size_t cls = classOf(bytes);
+        FreeBlock* b = static_cast<FreeBlock*>(p);
+        b->next = freeLists[cls];
+        freeLists[cls] = b;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+public:
+    explicit TPoolResource(size_t maxClass = 1024 * 1024, size_t chunk = 256 * 1024,
+                           std::pmr::memory_resource* up = std::pmr::new_delete_resource())
+        : upstream(up), maxClassLog(std::max(log2ceil(maxClass), minClassLog)), chunkSize(chunk),
+          freeLists(maxClassLog - minClassLog + 1, nullptr) {}
+
+    TPoolResource(const TPoolResource&) = delete;
+    TPoolResource& operator=(const TPoolResource&) = delete;
+
+    ~TPoolResource() override {
+        release();
+    }
+
+    // Вернуть вышестоящему источнику все куски; объекты из пула
+    // к этому моменту должны быть уничтожены
+    void release() noexcept {
+        for (const Chunk& c : chunks)
+            upstream->deallocate(c.mem, c.size, alignof(std::max_align_t));
+        chunks.clear();
+        std::fill(freeLists.begin(), freeLists.end(), nullptr);
+    }
+
+    size_t chunkCount() const noexcept { return chunks.size(); }
+};
+
+#endif
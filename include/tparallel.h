@@ -0,0 +1,372 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Пул потоков с привязкой к процессорам и учетом топологии NUMA
+
+#ifndef __TParallel_H__
+#define __TParallel_H__
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Топология NUMA: список узлов и доступных процессу процессоров каждого узла.
+// Если топологию узнать не удалось, считается, что узел один.
+class TNumaTopology {
+    std::vector<std::vector<size_t>> nodeCpus;
+
+#if defined(__linux__)
+    // Разбор списка вида "0-3,8-11"
+    static std::vector<size_t> parseCpuList(const std::string& s) {
+        std::vector<size_t> res;
+        std::stringstream ss(s);
+        std::string part;
+        while (std::getline(ss, part, ',')) {
+            if (part.empty() || part == "\n")
+                continue;
+            size_t dash = part.find('-');
+            size_t lo = std::stoul(part.substr(0, dash));
+            size_t hi = dash == std::string::npos ? lo : std::stoul(part.substr(dash + 1));
+            for (size_t c = lo; c <= hi; c++)
+                res.push_back(c);
+        }
+        return res;
+    }
+#endif
+
+    TNumaTopology() {
+#if defined(__linux__)
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        bool haveMask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+        for (size_t node = 0;; node++) {
+            std::ifstream f("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if (!f)
+                break;
+            std::string line;
+            std::getline(f, line);
+            std::vector<size_t> cpus;
+            for (size_t c : parseCpuList(line)) {
+                if (!haveMask || (c < CPU_SETSIZE && CPU_ISSET(c, &allowed)))
+                    cpus.push_back(c);
+            }
+            if (!cpus.empty())
+                nodeCpus.push_back(cpus);
+        }
+        if (nodeCpus.empty() && haveMask) {
+            std::vector<size_t> cpus;
+            for (size_t c = 0; c < CPU_SETSIZE; c++) {
+                if (CPU_ISSET(c, &allowed))
+                    cpus.push_back(c);
+            }
+            if (!cpus.empty())
+                nodeCpus.push_back(cpus);
+        }
+#elif defined(_WIN32)
+        ULONG highest = 0;
+        if (GetNumaHighestNodeNumber(&highest)) {
+            for (ULONG node = 0; node <= highest; node++) {
+                ULONGLONG mask = 0;
+                if (!GetNumaNodeProcessorMask(UCHAR(node), &mask))
+                    continue;
+                std::vector<size_t> cpus;
+                for (size_t c = 0; c < sizeof(DWORD_PTR) * 8; c++) {
+                    if (mask & (ULONGLONG(1) << c))
+                        cpus.push_back(c);
+                }
+                if (!cpus.empty())
+                    nodeCpus.push_back(cpus);
+            }
+        }
+#endif
+        if (nodeCpus.empty()) {
+            std::vector<size_t> cpus(std::max(1u, std::thread::hardware_concurrency()));
+            for (size_t c = 0; c < cpus.size(); c++)
+                cpus[c] = c;
+            nodeCpus.push_back(cpus);
+        }
+    }
+
+public:
+    static const TNumaTopology& get() {
+        static const TNumaTopology topology;
+        return topology;
+    }
+
+    size_t nodeCount() const noexcept { return nodeCpus.size(); }
+
+    const std::vector<size_t>& cpus(size_t node) const {
+        if (node >= nodeCpus.size())
+            throw std::out_of_range("NUMA node index out of range");
+        return nodeCpus[node];
+    }
+
+    size_t cpuCount() const noexcept {
+        size_t res = 0;
+        for (const auto& c : nodeCpus)
+            res += c.size();
+        return res;
+    }
+};
+
+// Политика размещения данных (строк матрицы) по узлам NUMA:
+//   Default     - все строки создает вызывающий поток;
+//   Interleaved - строки по очереди распределяются между узлами;
+//   FirstTouch  - строки делятся между потоками пула так же, как в
+//                 parallelFor, и каждая создается своим потоком;
+//   Bind        - все строки создаются потоками, работающими на узле node.
+// Память достается узлу, поток которого первым записал в нее.
+struct TPlacement {
+    enum Kind { Default, Interleaved, FirstTouch, Bind };
+
+    Kind kind;
+    size_t node;
+
+    TPlacement(Kind k = Default, size_t n = 0) : kind(k), node(n) {}
+
+    static TPlacement interleaved() { return TPlacement(Interleaved); }
+    static TPlacement firstTouch() { return TPlacement(FirstTouch); }
+    static TPlacement bind(size_t node) { return TPlacement(Bind, node); }
+};
+
+// Пул потоков фиксированного размера.
+// Рабочие потоки равномерно распределяются по процессорам, упорядоченным
+// по узлам NUMA, поэтому соседние номера потоков попадают на один узел.
+// Диапазоны parallelFor делятся статически: поток w всегда получает одну и
+// ту же часть [begin, end), так что данные, впервые записанные потоком при
+// инициализации, им же и обрабатываются.
+// Вызывать run/parallelFor из рабочего потока того же пула нельзя.
+class TThreadPool {
+    std::vector<std::thread> workers;
+    std::vector<size_t> workerCpu;
+    std::vector<size_t> workerNode;
+    bool pinned;
+
+    std::mutex runMutex;
+    std::mutex m;
+    std::condition_variable cvStart, cvDone;
+    std::function<void(size_t)> task;
+    size_t generation = 0;
+    size_t pending = 0;
+    bool stop = false;
+    std::exception_ptr error;
+
+    bool pin(std::thread& t, size_t cpu) {
+#if defined(__linux__)
+        if (cpu >= CPU_SETSIZE)
+            return false;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(t.native_handle(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+        if (cpu >= sizeof(DWORD_PTR) * 8)
+            return false;
+        return SetThreadAffinityMask(t.native_handle(), DWORD_PTR(1) << cpu) != 0;
+#else
+        (void)t; (void)cpu;
+        return false;
+#endif
+    }
+
+    void workerLoop(size_t w) {
+        size_t seen = 0;
+        for (;;) {
+            std::function<void(size_t)>* f;
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cvStart.wait(lock, [&] { return stop || generation != seen; });
+                if (stop)
+                    return;
+                seen = generation;
+                f = &task;
+            }
+            try {
+                (*f)(w);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(m);
+                if (!error)
+                    error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(m);
+            if (--pending == 0)
+                cvDone.notify_one();
+        }
+    }
+
+public:
+    // threads == 0 - по числу доступных процессоров
+    explicit TThreadPool(size_t threads = 0, bool pinWorkers = true) : pinned(false) {
+        const TNumaTopology& topo = TNumaTopology::get();
+        std::vector<size_t> order, orderNode;
+        for (size_t node = 0; node < topo.nodeCount(); node++) {
+            for (size_t c : topo.cpus(node)) {
+                order.push_back(c);
+                orderNode.push_back(node);
+            }
+        }
+        if (threads == 0)
+            threads = order.size();
+
+        workerCpu.resize(threads);
+        workerNode.resize(threads);
+        for (size_t w = 0; w < threads; w++) {
+            size_t idx = w * order.size() / threads;
+            workerCpu[w] = order[idx];
+            workerNode[w] = orderNode[idx];
+        }
+
+        workers.reserve(threads);
+        bool allPinned = pinWorkers;
+        for (size_t w = 0; w < threads; w++) {
+            workers.emplace_back(&TThreadPool::workerLoop, this, w);
+            if (pinWorkers)
+                allPinned = pin(workers.back(), workerCpu[w]) && allPinned;
+        }
+        pinned = allPinned;
+    }
+
+    TThreadPool(const TThreadPool&) = delete;
+    TThreadPool& operator=(const TThreadPool&) = delete;
+
+    ~TThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stop = true;
+        }
+        cvStart.notify_all();
+        for (auto& t : workers)
+            t.join();
+    }
+
+    size_t size() const noexcept { return workers.size(); }
+
+    // Удалось ли закрепить все потоки за процессорами
+    bool isPinned() const noexcept { return pinned; }
+
+    size_t cpuOf(size_t worker) const { return workerCpu.at(worker); }
+    size_t nodeOf(size_t worker) const { return workerNode.at(worker); }
+
+    // Начало части диапазона [begin, end), закрепленной за потоком worker
+    size_t partBegin(size_t begin, size_t end, size_t worker) const noexcept {
+        return begin + (end - begin) * worker / workers.size();
+    }
+
+    // Выполнить f(w) в каждом рабочем потоке и дождаться завершения.
+    // Первое выброшенное исключение передается вызывающему.
+    void run(std::function<void(size_t)> f) {
+        std::lock_guard<std::mutex> runLock(runMutex);
+        std::exception_ptr err;
+        {
+            std::unique_lock<std::mutex> lock(m);
+            task = std::move(f);
+            error = nullptr;
+            pending = workers.size();
+            generation++;
+            cvStart.notify_all();
+            cvDone.wait(lock, [&] { return pending == 0; });
+            task = nullptr;
+            err = error;
+        }
+        if (err)
+            std::rethrow_exception(err);
+    }
+
+    // f(lo, hi, worker) для статически закрепленных частей [begin, end)
+    template<typename F>
+    void parallelFor(size_t begin, size_t end, F&& f) {
+        run([&](size_t w) {
+            size_t lo = partBegin(begin, end, w);
+            size_t hi = partBegin(begin, end, w + 1);
+            if (lo < hi)
+                f(lo, hi, w);
+        });
+    }
+
+    // Вызвать f(i) для i из [0, n) в потоках, выбранных политикой размещения
+    template<typename F>
+    void forEachPlaced(size_t n, const TPlacement& placement, F&& f) {
+        switch (placement.kind) {
+        case TPlacement::Default:
+            for (size_t i = 0; i < n; i++)
+                f(i);
+            break;
+        case TPlacement::FirstTouch:
+            parallelFor(0, n, [&](size_t lo, size_t hi, size_t) {
+                for (size_t i = lo; i < hi; i++)
+                    f(i);
+            });
+            break;
+        case TPlacement::Interleaved: {
+            // Узлы, на которых есть потоки пула, и номер потока внутри узла
+            std::vector<size_t> nodes;
+            for (size_t w = 0; w < size(); w++) {
+                if (std::find(nodes.begin(), nodes.end(), workerNode[w]) == nodes.end())
+                    nodes.push_back(workerNode[w]);
+            }
+            run([&](size_t w) {
+                size_t d = std::find(nodes.begin(), nodes.end(), workerNode[w]) - nodes.begin();
+                size_t rank = 0, count = 0;
+                for (size_t u = 0; u < size(); u++) {
+                    if (workerNode[u] == workerNode[w]) {
+                        if (u < w)
+                            rank++;
+                        count++;
+                    }
+                }
+                for (size_t i = d; i < n; i += nodes.size()) {
+                    if ((i / nodes.size()) % count == rank)
+                        f(i);
+                }
+            });
+            break;
+        }
+        case TPlacement::Bind: {
+            std::vector<size_t> local;
+            for (size_t w = 0; w < size(); w++) {
+                if (workerNode[w] == placement.node)
+                    local.push_back(w);
+            }
+            if (local.empty())
+                throw std::out_of_range("Thread pool has no workers on the requested NUMA node");
+            run([&](size_t w) {
+                size_t rank = std::find(local.begin(), local.end(), w) - local.begin();
+                if (rank == local.size())
+                    return;
+                size_t lo = n * rank / local.size();
+                size_t hi = n * (rank + 1) / local.size();
+                for (size_t i = lo; i < hi; i++)
+                    f(i);
+            });
+            break;
+        }
+        }
+    }
+
+    // Общий пул на все доступные процессоры
+    static TThreadPool& global() {
+        static TThreadPool pool;
+        return pool;
+    }
+};
+
+#endif
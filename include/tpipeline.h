@@ -0,0 +1,274 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Конвейер обработки потока данных: стадии в своих потоках, ограниченные очереди
+
+#ifndef __TPipeline_H__
+#define __TPipeline_H__
+
+#include <deque>
+#include <map>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <stdexcept>
+#include <type_traits>
+
+// Очередь ограниченной емкости между стадиями.
+// push ждет, пока появится место (так медленная стадия притормаживает
+// предыдущие), pop ждет элемента; после close очередь отдает оставшееся и
+// затем сообщает о конце, после cancel - сразу.
+template<typename T>
+class TBoundedQueue {
+    std::deque<T> items;
+    size_t cap;
+    bool closed = false;
+    std::mutex m;
+    std::condition_variable notFull, notEmpty;
+
+public:
+    explicit TBoundedQueue(size_t capacity) : cap(capacity == 0 ? 1 : capacity) {}
+
+    // false - очередь закрыта, элемент не принят
+    bool push(T val) {
+        std::unique_lock<std::mutex> lock(m);
+        notFull.wait(lock, [&] { return closed || items.size() < cap; });
+        if (closed)
+            return false;
+        items.push_back(std::move(val));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // false - очередь закрыта и пуста
+    bool pop(T& val) {
+        std::unique_lock<std::mutex> lock(m);
+        notEmpty.wait(lock, [&] { return closed || !items.empty(); });
+        if (items.empty())
+            return false;
+        val = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(m);
+        closed = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+    void cancel() {
+        std::lock_guard<std::mutex> lock(m);
+        closed = true;
+        items.clear();
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+    size_t capacity() const noexcept { return cap; }
+};
+
+// Конвейер: источник -> стадии преобразования -> приемник.
+// Каждая стадия работает в своих потоках (преобразование - в заданном
+// числе), стадии связаны очередями емкости queueCapacity, поэтому
+// пропускная способность определяется самой медленной стадией, а память -
+// числом элементов в очередях. Приемник получает элементы в порядке
+// источника; стадии после многопоточной получают их в произвольном порядке.
+// Число элементов между источником и приемником ограничено окном (емкость
+// очередей плюс число потоков), иначе отставший поток многопоточной стадии
+// заставил бы приемник копить сколько угодно элементов, пришедших раньше.
+// Функция многопоточной стадии вызывается одновременно из нескольких потоков.
+// Исключение в любой стадии останавливает весь конвейер и передается из run.
+//
+//   TPipeline p(4);
+//   p.source([&]() -> std::optional<TDynamicMatrix<double>> { ... })
+//    .map([&](TDynamicMatrix<double> m) { return m * fixed; }, 2)
+//    .sink([&](TDynamicMatrix<double> r) { out << r; });
+//   p.run();
+class TPipeline {
+    size_t capacity;
+    std::vector<std::function<void()>> bodies;   // Тела потоков всех стадий
+    std::vector<std::function<void()>> cancels;  // Отмена всех очередей
+    bool hasSource = false, hasSink = false;
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    size_t inFlight = 0, window = 0; // Элементы, выданные источником и еще не принятые приемником
+    bool stopped = false;
+    std::mutex flowMutex;
+    std::condition_variable flowCv;
+
+    // Источник ждет места в окне; false - конвейер остановлен
+    bool acquire() {
+        std::unique_lock<std::mutex> lock(flowMutex);
+        flowCv.wait(lock, [&] { return stopped || inFlight < window; });
+        if (stopped)
+            return false;
+        inFlight++;
+        return true;
+    }
+
+    void release() {
+        std::lock_guard<std::mutex> lock(flowMutex);
+        inFlight--;
+        flowCv.notify_one();
+    }
+
+    void fail(std::exception_ptr e) {
+        {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (error)
+                return;
+            error = e;
+        }
+        {
+            std::lock_guard<std::mutex> lock(flowMutex);
+            stopped = true;
+            flowCv.notify_all();
+        }
+        for (auto& c : cancels)
+            c();
+    }
+
+    template<typename T>
+    using TItem = std::pair<size_t, T>; // Номер элемента в источнике и значение
+
+    template<typename T>
+    std::shared_ptr<TBoundedQueue<TItem<T>>> makeQueue() {
+        auto q = std::make_shared<TBoundedQueue<TItem<T>>>(capacity);
+        cancels.push_back([q] { q->cancel(); });
+        return q;
+    }
+
+public:
+    // Выход стадии, к которому подключается следующая
+    template<typename T>
+    class TStage {
+        TPipeline* p;
+        std::shared_ptr<TBoundedQueue<TItem<T>>> out;
+
+    public:
+        TStage(TPipeline* pipeline, std::shared_ptr<TBoundedQueue<TItem<T>>> q) : p(pipeline), out(std::move(q)) {}
+
+        // Стадия U f(T) в threads потоках
+        template<typename F>
+        auto map(F f, size_t threads = 1) {
+            typedef std::decay_t<std::invoke_result_t<F&, T>> U;
+            if (threads == 0)
+                throw std::invalid_argument("Pipeline stage needs at least one thread");
+            auto in = out;
+            auto next = p->makeQueue<U>();
+            auto left = std::make_shared<std::atomic<size_t>>(threads);
+            auto fn = std::make_shared<F>(std::move(f));
+            TPipeline* pl = p;
+            for (size_t t = 0; t < threads; t++) {
+                p->bodies.push_back([pl, in, next, left, fn] {
+                    try {
+                        TItem<T> item;
+                        while (in->pop(item)) {
+                            if (!next->push(TItem<U>(item.first, (*fn)(std::move(item.second)))))
+                                break;
+                        }
+                    } catch (...) {
+                        pl->fail(std::current_exception());
+                    }
+                    if (--*left == 0)
+                        next->close();
+                });
+            }
+            return TStage<U>(p, next);
+        }
+
+        // Приемник f(T) в одном потоке; элементы приходят в порядке источника
+        template<typename F>
+        void sink(F f) {
+            if (p->hasSink)
+                throw std::logic_error("Pipeline already has a sink");
+            p->hasSink = true;
+            auto in = out;
+            TPipeline* pl = p;
+            p->bodies.push_back([pl, in, f]() mutable {
+                try {
+                    std::map<size_t, T> early; // Пришедшие раньше своей очереди
+                    size_t expected = 0;
+                    TItem<T> item;
+                    while (in->pop(item)) {
+                        if (item.first != expected) {
+                            early.emplace(item.first, std::move(item.second));
+                            continue;
+                        }
+                        f(std::move(item.second));
+                        pl->release();
+                        expected++;
+                        for (auto it = early.begin(); it != early.end() && it->first == expected; it = early.erase(it)) {
+                            f(std::move(it->second));
+                            pl->release();
+                            expected++;
+                        }
+                    }
+                } catch (...) {
+                    pl->fail(std::current_exception());
+                }
+            });
+        }
+    };
+
+    explicit TPipeline(size_t queueCapacity = 4) : capacity(queueCapacity) {}
+
+    TPipeline(const TPipeline&) = delete;
+    TPipeline& operator=(const TPipeline&) = delete;
+
+    size_t queueCapacity() const noexcept { return capacity; }
+
+    // Источник: f() возвращает очередной элемент или пустой optional в конце
+    template<typename F>
+    auto source(F f) {
+        typedef typename std::decay_t<std::invoke_result_t<F&>>::value_type T;
+        if (hasSource)
+            throw std::logic_error("Pipeline already has a source");
+        hasSource = true;
+        auto next = makeQueue<T>();
+        bodies.push_back([this, next, f]() mutable {
+            try {
+                for (size_t seq = 0; acquire(); seq++) {
+                    std::optional<T> v = f();
+                    if (!v || !next->push(TItem<T>(seq, std::move(*v))))
+                        break;
+                }
+            } catch (...) {
+                fail(std::current_exception());
+            }
+            next->close();
+        });
+        return TStage<T>(this, next);
+    }
+
+    // Запустить все стадии и дождаться конца потока данных
+    void run() {
+        if (!hasSource || !hasSink)
+            throw std::logic_error("Pipeline needs a source and a sink");
+        window = capacity * cancels.size() + bodies.size();
+        std::vector<std::thread> threads;
+        try {
+            for (auto& b : bodies)
+                threads.emplace_back(b);
+        } catch (...) {
+            fail(std::current_exception());
+        }
+        for (auto& t : threads)
+            t.join();
+        bodies.clear();
+        if (error)
+            std::rethrow_exception(error);
+    }
+};
+
+#endif
@@ -0,0 +1,229 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Матрицы в именованной разделяемой памяти: один экземпляр данных для
+// нескольких процессов на одной машине
+
+#ifndef __TShared_H__
+#define __TShared_H__
+
+#include "tmatrixio.h"
+
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <stdexcept>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Именованный сегмент разделяемой памяти (shm_open на POSIX, именованное
+// отображение на Windows). Create создает новый сегмент (имя не должно
+// быть занято) и удаляет его имя в деструкторе, если не вызван release;
+// процессы, уже подключившиеся к сегменту, продолжают с ним работать.
+// ReadWrite подключается с общей записью, Read - с копированием при
+// записи: изменения видны только в своем процессе.
+class TSharedMemory {
+    void* pData = nullptr;
+    size_t len = 0;
+    std::string segName;
+    bool owner = false;
+#if defined(_WIN32)
+    HANDLE hMap = nullptr;
+#endif
+
+    static std::string systemName(const std::string& name) {
+        if (name.empty())
+            throw std::invalid_argument("Shared memory name should not be empty");
+#if defined(_WIN32)
+        return "Local\\" + (name[0] == '/' ? name.substr(1) : name);
+#else
+        return name[0] == '/' ? name : "/" + name;
+#endif
+    }
+
+    void unmap() noexcept {
+#if defined(_WIN32)
+        if (pData != nullptr)
+            UnmapViewOfFile(pData);
+        if (hMap != nullptr)
+            CloseHandle(hMap);
+        hMap = nullptr;
+#else
+        if (pData != nullptr)
+            munmap(pData, len);
+        if (owner)
+            shm_unlink(segName.c_str());
+#endif
+        pData = nullptr;
+        len = 0;
+        owner = false;
+    }
+
+public:
+    enum TMode { Read, ReadWrite, Create };
+
+    // size используется только при создании
+    TSharedMemory(const std::string& name, TMode mode, size_t size = 0) : segName(systemName(name)) {
+        if (mode == Create && size == 0)
+            throw std::invalid_argument("Shared memory segment size should be greater than zero");
+#if defined(_WIN32)
+        if (mode == Create) {
+            hMap = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, DWORD(uint64_t(size) >> 32),
+                                      DWORD(size), segName.c_str());
+            if (hMap != nullptr && GetLastError() == ERROR_ALREADY_EXISTS) {
+                CloseHandle(hMap);
+                hMap = nullptr;
+            }
+        } else {
+            hMap = OpenFileMappingA(mode == Read ? FILE_MAP_COPY : FILE_MAP_WRITE, FALSE, segName.c_str());
+        }
+        if (hMap == nullptr)
+            throw std::runtime_error("Cannot open shared memory segment: " + name);
+        pData = MapViewOfFile(hMap, mode == Read ? FILE_MAP_COPY : FILE_MAP_WRITE, 0, 0, mode == Create ? size : 0);
+        MEMORY_BASIC_INFORMATION info;
+        if (pData == nullptr || VirtualQuery(pData, &info, sizeof(info)) == 0) {
+            unmap();
+            throw std::runtime_error("Cannot map shared memory segment: " + name);
+        }
+        len = mode == Create ? size : info.RegionSize; // Размер существующего сегмента - с точностью до страницы
+#else
+        int fd = shm_open(segName.c_str(), mode == Create ? O_RDWR | O_CREAT | O_EXCL : mode == Read ? O_RDONLY : O_RDWR, 0644);
+        if (fd < 0)
+            throw std::runtime_error("Cannot open shared memory segment: " + name);
+        owner = mode == Create;
+        struct stat st;
+        if (mode == Create ? ftruncate(fd, off_t(size)) != 0 : fstat(fd, &st) != 0) {
+            close(fd);
+            unmap();
+            throw std::runtime_error("Cannot size shared memory segment: " + name);
+        }
+        len = mode == Create ? size : size_t(st.st_size);
+        if (len == 0) {
+            close(fd);
+            throw std::runtime_error("Shared memory segment is empty: " + name);
+        }
+        void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE, mode == Read ? MAP_PRIVATE : MAP_SHARED, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) {
+            len = 0;
+            unmap();
+            throw std::runtime_error("Cannot map shared memory segment: " + name);
+        }
+        pData = p;
+#endif
+    }
+
+    TSharedMemory(const TSharedMemory&) = delete;
+    TSharedMemory& operator=(const TSharedMemory&) = delete;
+
+    TSharedMemory(TSharedMemory&& s) noexcept : pData(s.pData), len(s.len), segName(std::move(s.segName)), owner(s.owner) {
+#if defined(_WIN32)
+        hMap = s.hMap;
+        s.hMap = nullptr;
+#endif
+        s.pData = nullptr;
+        s.len = 0;
+        s.owner = false;
+    }
+
+    ~TSharedMemory() {
+        unmap();
+    }
+
+    char* data() const noexcept { return static_cast<char*>(pData); }
+    size_t size() const noexcept { return len; }
+    const std::string& name() const noexcept { return segName; }
+    bool owns() const noexcept { return owner; }
+
+    // Оставить сегмент после разрушения создателя; удалить его - remove
+    void release() noexcept { owner = false; }
+
+    static void remove(const std::string& name) {
+#if !defined(_WIN32)
+        shm_unlink(systemName(name).c_str());
+#else
+        (void)name; // Отображение исчезает с последним дескриптором
+#endif
+    }
+};
+
+// Матрица в разделяемой памяти. Сегмент начинается с TBinaryHeader (как
+// двоичный файл: версия формата, тип элемента, порядок байтов, смещение
+// данных), за ним элементы по строкам. Создатель заполняет матрицу и
+// публикует ее: сигнатура заголовка записывается последней, поэтому
+// подключение к неопубликованному сегменту отвергается, а не видит
+// недописанные данные. Матрица работает прямо с памятью сегмента (режим
+// заимствования памяти) и действительна, пока существует объект.
+template<typename T>
+class TSharedMatrix {
+    TSharedMemory shm;
+    TBinaryHeader header;
+    TDynamicMatrix<T> m;
+
+    static size_t segmentBytes(size_t n) {
+        if (n == 0 || n > size_t(MAX_MATRIX_SIZE))
+            throw std::out_of_range("Matrix size should be greater than zero and not greater than MAX_MATRIX_SIZE");
+        return sizeof(TBinaryHeader) + n * n * sizeof(T);
+    }
+
+    // Заголовок нового сегмента без сигнатуры
+    static TBinaryHeader prepare(TSharedMemory& s, size_t n) {
+        TBinaryHeader h = makeBinaryHeader<T>(2, n, n);
+        TBinaryHeader stored = h;
+        std::memset(stored.magic, 0, sizeof(stored.magic));
+        std::memcpy(s.data(), &stored, sizeof(stored));
+        return h;
+    }
+
+    static TBinaryHeader attached(const TSharedMemory& s) {
+        if (s.size() < sizeof(TBinaryHeader))
+            throw std::runtime_error("Shared matrix segment is truncated");
+        TBinaryHeader h;
+        std::memcpy(&h, s.data(), sizeof(h));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        bool partial = true; // Сигнатура пуста или дописана не до конца
+        for (size_t k = 0; k < sizeof(h.magic); k++)
+            partial = partial && (h.magic[k] == 0 || h.magic[k] == "TMATRIX"[k]);
+        if (partial && std::memcmp(h.magic, "TMATRIX", 8) != 0)
+            throw std::runtime_error("Shared matrix segment is not published yet");
+        checkBinaryHeader<T>(h, 2, s.size());
+        return h;
+    }
+
+public:
+    // Новый сегмент с нулевой матрицей n x n; после заполнения - publish
+    TSharedMatrix(const std::string& name, size_t n)
+        : shm(name, TSharedMemory::Create, segmentBytes(n)), header(prepare(shm, n)),
+          m(reinterpret_cast<T*>(shm.data() + header.dataOffset), n, adopt) {}
+
+    // Новый опубликованный сегмент с копией src
+    TSharedMatrix(const std::string& name, const TDynamicMatrix<T>& src) : TSharedMatrix(name, src.size()) {
+        for (size_t i = 0; i < src.size(); i++)
+            std::copy(src[i].data(), src[i].data() + src.size(), m[i].data());
+        publish();
+    }
+
+    // Подключение к опубликованному сегменту
+    explicit TSharedMatrix(const std::string& name, TSharedMemory::TMode mode = TSharedMemory::Read)
+        : shm(name, mode == TSharedMemory::Create ? throw std::invalid_argument("Use the size constructor to create a shared matrix") : mode),
+          header(attached(shm)), m(reinterpret_cast<T*>(shm.data() + header.dataOffset), size_t(header.rows), adopt) {}
+
+    void publish() noexcept {
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(shm.data(), header.magic, sizeof(header.magic));
+    }
+
+    TDynamicMatrix<T>& matrix() noexcept { return m; }
+    const TDynamicMatrix<T>& matrix() const noexcept { return m; }
+
+    TSharedMemory& segment() noexcept { return shm; }
+    const TSharedMemory& segment() const noexcept { return shm; }
+};
+
+#endif
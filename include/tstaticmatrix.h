@@ -0,0 +1,234 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Векторы и матрицы фиксированного размера на стеке
+
+#ifndef __TStaticMatrix_H__
+#define __TStaticMatrix_H__
+
+#include "tmatrix.h"
+
+// Статический вектор -
+// шаблонный вектор фиксированного размера N без динамической памяти.
+// Все операции constexpr, циклы полностью развернуты.
+template<typename T, size_t N>
+class TStaticVector {
+    static_assert(N > 0, "Vector size should be greater than zero");
+
+    T pMem[N] = {};
+
+    template<size_t... I>
+    constexpr T dot(const TStaticVector& v, std::index_sequence<I...>) const {
+        return (T() + ... + (pMem[I] * v.pMem[I]));
+    }
+
+public:
+    constexpr TStaticVector() = default;
+
+    // Преобразование из динамического вектора того же размера
+    explicit TStaticVector(const TDynamicVector<T>& v) {
+        if (v.size() != N)
+            throw std::invalid_argument("Dynamic vector size must match static vector size");
+        static_for<N>([&](auto i) { pMem[i] = v[i]; });
+    }
+
+    // Преобразование в динамический вектор
+    operator TDynamicVector<T>() const {
+        TDynamicVector<T> res(N);
+        static_for<N>([&](auto i) { res[i] = pMem[i]; });
+        return res;
+    }
+
+    constexpr size_t size() const noexcept { return N; }
+
+    // Индексация
+    constexpr T& operator[](size_t ind) { return pMem[ind]; }
+    constexpr const T& operator[](size_t ind) const { return pMem[ind]; }
+
+    // Индексация с контролем
+    constexpr T& at(size_t ind) {
+        if (ind >= N)
+            throw out_of_range("Index out of range");
+        return pMem[ind];
+    }
+
+    constexpr const T& at(size_t ind) const {
+        if (ind >= N)
+            throw out_of_range("Index out of range");
+        return pMem[ind];
+    }
+
+    // Сравнение
+    constexpr bool operator==(const TStaticVector& v) const noexcept {
+        bool res = true;
+        static_for<N>([&](auto i) { res = res && pMem[i] == v.pMem[i]; });
+        return res;
+    }
+
+    constexpr bool operator!=(const TStaticVector& v) const noexcept {
+        return !(*this == v);
+    }
+
+    // Скалярные операции
+    constexpr TStaticVector operator+(T val) const {
+        TStaticVector res;
+        static_for<N>([&](auto i) { res.pMem[i] = pMem[i] + val; });
+        return res;
+    }
+
+    constexpr TStaticVector operator-(T val) const {
+        TStaticVector res;
+        static_for<N>([&](auto i) { res.pMem[i] = pMem[i] - val; });
+        return res;
+    }
+
+    constexpr TStaticVector operator*(T val) const {
+        TStaticVector res;
+        static_for<N>([&](auto i) { res.pMem[i] = pMem[i] * val; });
+        return res;
+    }
+
+    // Векторные операции; размеры совпадают по построению
+    constexpr TStaticVector operator+(const TStaticVector& v) const {
+        TStaticVector res;
+        static_for<N>([&](auto i) { res.pMem[i] = pMem[i] + v.pMem[i]; });
+        return res;
+    }
+
+    constexpr TStaticVector operator-(const TStaticVector& v) const {
+        TStaticVector res;
+        static_for<N>([&](auto i) { res.pMem[i] = pMem[i] - v.pMem[i]; });
+        return res;
+    }
+
+    constexpr T operator*(const TStaticVector& v) const {
+        return dot(v, std::make_index_sequence<N>());
+    }
+
+    // Ввод/вывод
+    friend istream& operator>>(istream& istr, TStaticVector& v) {
+        for (size_t i = 0; i < N; i++) {
+            istr >> v.pMem[i];
+        }
+        return istr;
+    }
+
+    friend ostream& operator<<(ostream& ostr, const TStaticVector& v) {
+        for (size_t i = 0; i < N; i++) {
+            ostr << v.pMem[i] << " ";
+        }
+        return ostr;
+    }
+};
+
+// Статическая матрица -
+// шаблонная квадратная матрица N x N без динамической памяти
+template<typename T, size_t N>
+class TStaticMatrix {
+    TStaticVector<T, N> pMem[N] = {};
+
+public:
+    constexpr TStaticMatrix() = default;
+
+    // Преобразование из динамической матрицы того же размера
+    explicit TStaticMatrix(const TDynamicMatrix<T>& m) {
+        if (m.size() != N)
+            throw std::invalid_argument("Dynamic matrix size must match static matrix size");
+        static_for<N>([&](auto i) { pMem[i] = TStaticVector<T, N>(m[i]); });
+    }
+
+    // Преобразование в динамическую матрицу
+    operator TDynamicMatrix<T>() const {
+        TDynamicMatrix<T> res(N);
+        static_for<N>([&](auto i) {
+            static_for<N>([&](auto j) { res[i][j] = pMem[i][j]; });
+        });
+        return res;
+    }
+
+    constexpr size_t size() const noexcept { return N; }
+
+    // Индексация
+    constexpr TStaticVector<T, N>& operator[](size_t ind) { return pMem[ind]; }
+    constexpr const TStaticVector<T, N>& operator[](size_t ind) const { return pMem[ind]; }
+
+    constexpr TStaticVector<T, N>& at(size_t ind) {
+        if (ind >= N)
+            throw out_of_range("Index out of range");
+        return pMem[ind];
+    }
+
+    constexpr const TStaticVector<T, N>& at(size_t ind) const {
+        if (ind >= N)
+            throw out_of_range("Index out of range");
+        return pMem[ind];
+    }
+
+    // Сравнение
+    constexpr bool operator==(const TStaticMatrix& m) const noexcept {
+        bool res = true;
+        static_for<N>([&](auto i) { res = res && pMem[i] == m.pMem[i]; });
+        return res;
+    }
+
+    constexpr bool operator!=(const TStaticMatrix& m) const noexcept {
+        return !(*this == m);
+    }
+
+    // Матрично-скалярные операции
+    constexpr TStaticMatrix operator*(const T& val) const {
+        TStaticMatrix res;
+        static_for<N>([&](auto i) { res.pMem[i] = pMem[i] * val; });
+        return res;
+    }
+
+    // Матрично-векторные операции
+    constexpr TStaticVector<T, N> operator*(const TStaticVector<T, N>& v) const {
+        TStaticVector<T, N> res;
+        static_for<N>([&](auto i) { res[i] = pMem[i] * v; });
+        return res;
+    }
+
+    // Матрично-матричные операции
+    constexpr TStaticMatrix operator+(const TStaticMatrix& m) const {
+        TStaticMatrix res;
+        static_for<N>([&](auto i) { res.pMem[i] = pMem[i] + m.pMem[i]; });
+        return res;
+    }
+
+    constexpr TStaticMatrix operator-(const TStaticMatrix& m) const {
+        TStaticMatrix res;
+        static_for<N>([&](auto i) { res.pMem[i] = pMem[i] - m.pMem[i]; });
+        return res;
+    }
+
+    constexpr TStaticMatrix operator*(const TStaticMatrix& m) const {
+        TStaticMatrix res;
+        static_for<N>([&](auto i) {
+            static_for<N>([&](auto j) {
+                T sum = T();
+                static_for<N>([&](auto k) { sum += pMem[i][k] * m.pMem[k][j]; });
+                res.pMem[i][j] = sum;
+            });
+        });
+        return res;
+    }
+
+    // Ввод/вывод
+    friend istream& operator>>(istream& istr, TStaticMatrix& m) {
+        for (size_t i = 0; i < N; i++) {
+            istr >> m.pMem[i];
+        }
+        return istr;
+    }
+
+    friend ostream& operator<<(ostream& ostr, const TStaticMatrix& m) {
+        for (size_t i = 0; i < N; i++) {
+            ostr << m.pMem[i] << std::endl;
+        }
+        return ostr;
+    }
+};
+
+#endif
@@ -0,0 +1,219 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Быстрый разбор и вывод чисел в текстовом формате без форматированного ввода/вывода iostream
+
+#ifndef __TTextIO_H__
+#define __TTextIO_H__
+
+#include <istream>
+#include <ostream>
+#include <locale>
+#include <vector>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <charconv>
+#include <type_traits>
+#include <algorithm>
+
+// Типы, которые разбираются быстрым путем: числа, но не символы и не bool
+// (для них operator>> iostream читает не число, а символ или 0/1)
+template<typename T>
+struct is_text_number : std::integral_constant<bool,
+    std::is_floating_point<T>::value ||
+    (std::is_integral<T>::value && !std::is_same<T, bool>::value && sizeof(T) > 1 &&
+     !std::is_same<T, wchar_t>::value && !std::is_same<T, char16_t>::value &&
+     !std::is_same<T, char32_t>::value)> {};
+
+// Ошибка разбора текста с позицией (строка и столбец в байтах, с единицы)
+class TTextParseError : public std::runtime_error {
+    size_t ln, col;
+
+public:
+    TTextParseError(const std::string& what, size_t line, size_t column)
+        : std::runtime_error(what + " at line " + std::to_string(line) + ", column " + std::to_string(column)),
+          ln(line), col(column) {}
+
+    size_t line() const noexcept { return ln; }
+    size_t column() const noexcept { return col; }
+};
+
+// Разделители элементов - пробельные символы локали "C"
+inline bool isTextSpace(char c) noexcept {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+inline const char* skipTextSpace(const char* first, const char* last) noexcept {
+    while (first != last && isTextSpace(*first))
+        first++;
+    return first;
+}
+
+// Разбор одного числа в начале [first, last). Возвращает указатель за
+// последним символом числа или nullptr, если число записано неверно.
+// Как и iostream, допускает ведущий '+'.
+template<typename T>
+const char* parseTextNumber(const char* first, const char* last, T& val) {
+    static_assert(is_text_number<T>::value, "Fast text parsing supports numeric types only");
+    if (first != last && *first == '+' && last - first > 1 && first[1] != '-')
+        first++;
+    std::from_chars_result r = std::from_chars(first, last, val);
+    if (r.ec != std::errc())
+        return nullptr;
+    return r.ptr;
+}
+
+// Чтение одного числа прямо из буфера потока, минуя sentry, локаль и
+// num_get: пропускаются пробелы, лексема до следующего пробела копируется в
+// локальный буфер и разбирается parseTextNumber. При ошибке возвращает
+// флаги для setstate (failbit и, если поток кончился, eofbit).
+template<typename T>
+std::ios_base::iostate readTextNumber(std::streambuf& sb, T& val) {
+    typedef std::char_traits<char> traits;
+    traits::int_type c = sb.sgetc();
+    while (!traits::eq_int_type(c, traits::eof()) && isTextSpace(traits::to_char_type(c)))
+        c = sb.snextc();
+    if (traits::eq_int_type(c, traits::eof()))
+        return std::ios_base::eofbit | std::ios_base::failbit;
+
+    char small[64];
+    std::string big;
+    size_t len = 0;
+    while (!traits::eq_int_type(c, traits::eof()) && !isTextSpace(traits::to_char_type(c))) {
+        if (len < sizeof(small)) {
+            small[len] = traits::to_char_type(c);
+        } else {
+            if (big.empty())
+                big.assign(small, len);
+            big.push_back(traits::to_char_type(c));
+        }
+        len++;
+        c = sb.snextc();
+    }
+    const char* token = big.empty() ? small : big.data();
+    const char* end = parseTextNumber(token, token + len, val);
+    std::ios_base::iostate state = traits::eq_int_type(c, traits::eof()) ? std::ios_base::eofbit : std::ios_base::goodbit;
+    if (end != token + len)
+        state |= std::ios_base::failbit;
+    return state;
+}
+
+// Чтение n чисел из потока в p. Для числовых типов - быстрый путь через
+// буфер потока, для остальных - обычный operator>>.
+template<typename T>
+std::istream& readTextNumbers(std::istream& istr, T* p, size_t n) {
+    if constexpr (is_text_number<T>::value) {
+        std::istream::sentry s(istr);
+        if (!s)
+            return istr;
+        std::streambuf& sb = *istr.rdbuf();
+        for (size_t i = 0; i < n; i++) {
+            std::ios_base::iostate state = readTextNumber(sb, p[i]);
+            if (state != std::ios_base::goodbit) {
+                istr.setstate(state);
+                if (state & std::ios_base::failbit)
+                    return istr;
+            }
+        }
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            istr >> p[i];
+        }
+    }
+    return istr;
+}
+
+// Буферизованный вывод чисел в поток.
+// Числа форматируются std::to_chars в буфер, который передается потоку
+// крупными блоками. Результат побайтно совпадает с operator<< потока:
+// быстрый путь используется, только если состояние потока (ширина поля,
+// флаги, локаль) не влияет на вывод иначе, чем точность и
+// fixed/scientific; иначе и для нечисловых типов вызывается operator<<.
+class TTextWriter {
+    std::ostream& ostr;
+    std::vector<char> buf;
+    size_t len = 0;
+    bool fast;
+    std::chars_format format;
+    int precision;
+
+    // Свободное место, с которым пробуется быстрый путь. Его хватает на
+    // целые и double в general/scientific; более длинные числа (fixed с
+    // большим порядком, вроде 1e300) to_chars не помещает, и их выводит
+    // запасной путь через operator<<
+    static constexpr size_t numberMax = 128;
+    static constexpr size_t capacityMax = 1 << 16;
+
+public:
+    // Емкость буфера для вывода count чисел: короткие векторы не требуют
+    // выделять и обнулять буфер полного размера
+    static size_t capacityFor(size_t count) noexcept {
+        return count >= capacityMax / 32 ? capacityMax : std::min(count * 32 + 2 * numberMax, capacityMax);
+    }
+
+    explicit TTextWriter(std::ostream& o, size_t capacity = capacityMax)
+        : ostr(o), buf(capacity < 2 * numberMax ? 2 * numberMax : capacity) {
+        const std::ios_base::fmtflags f = ostr.flags();
+        const std::ios_base::fmtflags floatfield = f & std::ios_base::floatfield;
+        const std::ios_base::fmtflags changing = std::ios_base::showpos | std::ios_base::showpoint |
+            std::ios_base::uppercase | std::ios_base::showbase;
+        fast = ostr.width() == 0 && (f & changing) == 0 &&
+            ((f & std::ios_base::basefield) == std::ios_base::dec || (f & std::ios_base::basefield) == 0) &&
+            floatfield != (std::ios_base::fixed | std::ios_base::scientific) &&
+            ostr.getloc() == std::locale::classic();
+        format = floatfield == std::ios_base::fixed ? std::chars_format::fixed :
+            floatfield == std::ios_base::scientific ? std::chars_format::scientific : std::chars_format::general;
+        precision = int(ostr.precision());
+    }
+
+    TTextWriter(const TTextWriter&) = delete;
+    TTextWriter& operator=(const TTextWriter&) = delete;
+
+    void put(char c) {
+        if (len == buf.size())
+            flush();
+        buf[len++] = c;
+    }
+
+    template<typename T>
+    void number(const T& val) {
+        if constexpr (is_text_number<T>::value) {
+            if (fast) {
+                if (buf.size() - len < numberMax)
+                    flush();
+                char* first = buf.data() + len;
+                std::to_chars_result r;
+                if constexpr (std::is_floating_point<T>::value)
+                    r = std::to_chars(first, buf.data() + buf.size(), val, format, precision);
+                else
+                    r = std::to_chars(first, buf.data() + buf.size(), val);
+                if (r.ec == std::errc()) {
+                    len = r.ptr - buf.data();
+                    return;
+                }
+            }
+        }
+        flush();
+        ostr << val;
+    }
+
+    // Передать накопленное потоку (без сброса самого потока)
+    void flush() {
+        if (len != 0)
+            ostr.write(buf.data(), std::streamsize(len));
+        len = 0;
+    }
+};
+
+// Вывод n чисел из p, каждое с завершающим пробелом
+template<typename T>
+void writeTextNumbers(TTextWriter& w, const T* p, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        w.number(p[i]);
+        w.put(' ');
+    }
+}
+
+#endif
@@ -0,0 +1,263 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Треугольные матрицы в упакованном виде, решение треугольных систем
+// (прямая и обратная подстановка)
+
+#ifndef __TTriangular_H__
+#define __TTriangular_H__
+
+#include "tmatrix.h"
+
+#include <vector>
+#include <stdexcept>
+
+// Ширина блока в блочном решении с многими правыми частями
+#ifndef TMATRIX_TRSM_BLOCK
+#define TMATRIX_TRSM_BLOCK 64
+#endif
+
+enum class TTriangle { Upper, Lower };
+enum class TDiagonal { NonUnit, Unit }; // Unit - диагональ считается единичной и не читается
+
+// Треугольная матрица n x n, хранящая только свой треугольник: строки
+// подряд в одном векторе длины n * (n + 1) / 2. Верхняя хранит в строке i
+// столбцы [i, n), нижняя - [0, i + 1).
+template<typename T>
+class TTriangularMatrix {
+    size_t n;
+    TTriangle tri;
+    TDynamicVector<T> mem;
+
+    static size_t packedSize(size_t s) {
+        if (s == 0)
+            throw out_of_range("Matrix size should be greater than zero");
+        if (s > MAX_MATRIX_SIZE)
+            throw std::out_of_range("Matrix size exceeds MAX_MATRIX_SIZE");
+        return s * (s + 1) / 2;
+    }
+
+    size_t offset(size_t i) const noexcept {
+        return tri == TTriangle::Upper ? i * n - i * (i - 1) / 2 : i * (i + 1) / 2;
+    }
+
+public:
+    explicit TTriangularMatrix(size_t s = 1, TTriangle t = TTriangle::Upper) : n(s), tri(t), mem(packedSize(s)) {}
+
+    size_t size() const noexcept { return n; }
+    TTriangle triangle() const noexcept { return tri; }
+
+    // Хранимые столбцы строки i: [colBegin(i), colEnd(i))
+    size_t colBegin(size_t i) const noexcept { return tri == TTriangle::Upper ? i : 0; }
+    size_t colEnd(size_t i) const noexcept { return tri == TTriangle::Upper ? n : i + 1; }
+
+    // Первый хранимый элемент строки i
+    T* row(size_t i) { return mem.data() + offset(i); }
+    const T* row(size_t i) const noexcept { return mem.data() + offset(i); }
+
+    // Упакованные элементы
+    TDynamicVector<T>& packed() noexcept { return mem; }
+    const TDynamicVector<T>& packed() const noexcept { return mem; }
+
+    T& at(size_t i, size_t j) {
+        if (i >= n || j < colBegin(i) || j >= colEnd(i))
+            throw out_of_range("Element is outside the stored triangle");
+        return row(i)[j - colBegin(i)];
+    }
+
+    // Элемент (i, j) с нулями вне треугольника
+    T get(size_t i, size_t j) const {
+        if (i >= n || j >= n)
+            throw out_of_range("Index out of range");
+        return j < colBegin(i) || j >= colEnd(i) ? T() : row(i)[j - colBegin(i)];
+    }
+
+    // Треугольник t матрицы m (остальное отбрасывается)
+    static TTriangularMatrix fromMatrix(const TDynamicMatrix<T>& m, TTriangle t = TTriangle::Upper) {
+        TTriangularMatrix res(m.size(), t);
+        for (size_t i = 0; i < res.n; i++)
+            std::copy(m[i].data() + res.colBegin(i), m[i].data() + res.colEnd(i), res.row(i));
+        return res;
+    }
+
+    TDynamicMatrix<T> toMatrix() const {
+        TDynamicMatrix<T> m(n);
+        for (size_t i = 0; i < n; i++)
+            std::copy(row(i), row(i) + (colEnd(i) - colBegin(i)), m[i].data() + colBegin(i));
+        return m;
+    }
+
+    bool operator==(const TTriangularMatrix& m) const noexcept {
+        return n == m.n && tri == m.tri && mem == m.mem;
+    }
+
+    bool operator!=(const TTriangularMatrix& m) const noexcept {
+        return !(*this == m);
+    }
+};
+
+// Доступ к треугольнику плотной и упакованной матрицы для общих алгоритмов:
+// at(i, c) - указатель на элемент (i, c), дальше по строке лежат следующие
+// столбцы треугольника
+template<typename T>
+struct TDenseTriangle {
+    const TDynamicMatrix<T>& m;
+    TTriangle tri;
+
+    size_t size() const noexcept { return m.size(); }
+    const T* at(size_t i, size_t c) const noexcept { return m[i].data() + c; }
+};
+
+template<typename T>
+struct TPackedTriangle {
+    const TTriangularMatrix<T>& m;
+    TTriangle tri;
+
+    size_t size() const noexcept { return m.size(); }
+    const T* at(size_t i, size_t c) const noexcept { return m.row(i) + (c - m.colBegin(i)); }
+};
+
+template<typename T, typename A>
+void check_triangle_diagonal(const A& a, TDiagonal diag) {
+    if (diag == TDiagonal::Unit)
+        return;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (*a.at(i, i) == T())
+            throw std::runtime_error("Triangular matrix is singular");
+    }
+}
+
+// x = A^-1 * x: подстановка со скалярным произведением по строке A
+template<typename T, typename A>
+void trsv_impl(const A& a, TDynamicVector<T>& x, TDiagonal diag) {
+    const size_t n = a.size();
+    if (x.size() != n)
+        throw std::invalid_argument("Matrix size and vector size must match for trsv");
+    check_triangle_diagonal<T>(a, diag);
+    T* px = x.data();
+    if (a.tri == TTriangle::Lower) {
+        for (size_t i = 0; i < n; i++) {
+            const T* r = a.at(i, 0);
+            T sum = px[i];
+            for (size_t p = 0; p < i; p++)
+                sum -= r[p] * px[p];
+            px[i] = diag == TDiagonal::Unit ? sum : sum / r[i];
+        }
+    } else {
+        for (size_t i = n; i-- > 0;) {
+            const T* r = a.at(i, i);
+            T sum = px[i];
+            for (size_t p = 1; p < n - i; p++)
+                sum -= r[p] * px[i + p];
+            px[i] = diag == TDiagonal::Unit ? sum : sum / r[0];
+        }
+    }
+}
+
+// B = alpha * A^-1 * B, B - n x m. Блочный алгоритм: блок строк X решается
+// построчными операциями над строками B (столбцы делятся между потоками
+// пула), а его вклад в остальные строки вычитается одним gemm над окнами
+// (строки делятся между потоками). При больших n почти вся работа идет
+// через gemm.
+template<typename T, typename A>
+void trsm_impl(const A& a, const T& alpha, const TMatrixView<T>& B, TDiagonal diag, TThreadPool& pool) {
+    const size_t n = a.size(), m = B.cols(), nb = TMATRIX_TRSM_BLOCK;
+    if (B.rows() != n)
+        throw std::invalid_argument("Matrix size and right-hand side rows must match for trsm");
+    check_triangle_diagonal<T>(a, diag);
+    const bool lower = a.tri == TTriangle::Lower;
+
+    std::vector<T*> rows(n);
+    for (size_t i = 0; i < n; i++)
+        rows[i] = B.row(i);
+    std::vector<TDynamicVector<T>> panelRows;
+
+    for (size_t step = 0; step < n; step += nb) {
+        // Блок строк [k0, k1): у нижней - сверху вниз, у верхней - снизу вверх
+        const size_t k0 = lower ? step : (n - step > nb ? n - step - nb : 0);
+        const size_t k1 = lower ? std::min(n, step + nb) : n - step;
+        pool.parallelFor(0, m, [&](size_t lo, size_t hi, size_t) {
+            if (lo == hi)
+                return;
+            if (step == 0 && alpha != T(1)) {
+                for (size_t i = 0; i < n; i++)
+                    for (size_t c = lo; c < hi; c++)
+                        rows[i][c] *= alpha;
+            }
+            for (size_t s = 0; s < k1 - k0; s++) {
+                const size_t i = lower ? k0 + s : k1 - 1 - s;
+                T* xi = rows[i];
+                const size_t p0 = lower ? k0 : i + 1, p1 = lower ? i : k1;
+                const T* r = a.at(i, p0);
+                for (size_t p = p0; p < p1; p++) {
+                    const T l = r[p - p0];
+                    const T* xp = rows[p];
+                    for (size_t c = lo; c < hi; c++)
+                        xi[c] -= l * xp[c];
+                }
+                if (diag == TDiagonal::NonUnit) {
+                    const T d = *a.at(i, i);
+                    for (size_t c = lo; c < hi; c++)
+                        xi[c] /= d;
+                }
+            }
+        });
+
+        // Остальные строки: B[rest] -= A[rest, k0:k1] * X[k0:k1]
+        const size_t r0 = lower ? k1 : 0, r1 = lower ? n : k0;
+        if (r0 == r1)
+            continue;
+        panelRows.clear();
+        panelRows.reserve(r1 - r0);
+        for (size_t i = r0; i < r1; i++)
+            panelRows.emplace_back(const_cast<T*>(a.at(i, k0)), k1 - k0, adopt);
+        const TMatrixView<T> panel(panelRows.data(), 0, 0, r1 - r0, k1 - k0);
+        const TMatrixView<T> X = B.rowRange(k0, k1 - k0);
+        pool.parallelFor(0, r1 - r0, [&](size_t lo, size_t hi, size_t) {
+            if (lo < hi)
+                gemm(T(-1), panel.rowRange(lo, hi - lo), X, T(1), B.rowRange(r0 + lo, hi - lo));
+        });
+    }
+}
+
+// Решение A * x = b на месте: x содержит b, на выходе - решение.
+// Используется только треугольник uplo плотной матрицы A.
+template<typename T>
+void trsv(TTriangle uplo, const TDynamicMatrix<T>& A, TDynamicVector<T>& x, TDiagonal diag = TDiagonal::NonUnit) {
+    trsv_impl(TDenseTriangle<T>{ A, uplo }, x, diag);
+}
+
+template<typename T>
+void trsv(const TTriangularMatrix<T>& A, TDynamicVector<T>& x, TDiagonal diag = TDiagonal::NonUnit) {
+    trsv_impl(TPackedTriangle<T>{ A, A.triangle() }, x, diag);
+}
+
+// Решение A * X = alpha * B на месте для всех столбцов B сразу
+template<typename T>
+void trsm(TTriangle uplo, const T& alpha, const TDynamicMatrix<T>& A, const TMatrixView<T>& B,
+          TDiagonal diag = TDiagonal::NonUnit, TThreadPool& pool = TThreadPool::global()) {
+    trsm_impl(TDenseTriangle<T>{ A, uplo }, alpha, B, diag, pool);
+}
+
+template<typename T>
+void trsm(TTriangle uplo, const T& alpha, const TDynamicMatrix<T>& A, TDynamicMatrix<T>& B,
+          TDiagonal diag = TDiagonal::NonUnit, TThreadPool& pool = TThreadPool::global()) {
+    if (&A == &B)
+        throw std::invalid_argument("trsm right-hand side must not alias the triangular matrix");
+    trsm_impl(TDenseTriangle<T>{ A, uplo }, alpha, B.view(), diag, pool);
+}
+
+template<typename T>
+void trsm(const T& alpha, const TTriangularMatrix<T>& A, const TMatrixView<T>& B,
+          TDiagonal diag = TDiagonal::NonUnit, TThreadPool& pool = TThreadPool::global()) {
+    trsm_impl(TPackedTriangle<T>{ A, A.triangle() }, alpha, B, diag, pool);
+}
+
+template<typename T>
+void trsm(const T& alpha, const TTriangularMatrix<T>& A, TDynamicMatrix<T>& B,
+          TDiagonal diag = TDiagonal::NonUnit, TThreadPool& pool = TThreadPool::global()) {
+    trsm_impl(TPackedTriangle<T>{ A, A.triangle() }, alpha, B.view(), diag, pool);
+}
+
+#endif
@@ -0,0 +1,147 @@
+#include "tasyncio.h"
+
+#include <gtest.h>
+#include <cstdio>
+
+static TDynamicMatrix<double> makeAsyncMatrix(size_t n)
+{
+  TDynamicMatrix<double> m(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      m[i][j] = i * 1000.0 + j;
+  return m;
+}
+
+static TAsyncOptions smallChunks(TIoBackend backend)
+{
+  TAsyncOptions opts;
+  opts.chunkBytes = 1000;
+  opts.queueDepth = 3;
+  opts.backend = backend;
+  return opts;
+}
+
+TEST(TAsyncIO, loader_matches_synchronous_load_with_thread_backend)
+{
+  TDynamicMatrix<double> m = makeAsyncMatrix(50);
+  saveBinary("test_tasyncio_threads.bin", m);
+  {
+    TAsyncMatrixLoader<double> loader("test_tasyncio_threads.bin", smallChunks(TIoBackend::Threads));
+
+    EXPECT_FALSE(loader.usesIoUring());
+    EXPECT_EQ(m, loader.get());
+    EXPECT_EQ(50, loader.rowsReady());
+  }
+  std::remove("test_tasyncio_threads.bin");
+}
+
+TEST(TAsyncIO, loader_matches_synchronous_load_with_default_backend)
+{
+  TDynamicMatrix<double> m = makeAsyncMatrix(64);
+  saveBinary("test_tasyncio_auto.bin", m);
+  {
+    TAsyncMatrixLoader<double> loader("test_tasyncio_auto.bin", smallChunks(TIoBackend::Auto));
+
+    EXPECT_EQ(m, loader.get());
+  }
+  std::remove("test_tasyncio_auto.bin");
+}
+
+TEST(TAsyncIO, early_rows_can_be_used_before_load_completes)
+{
+  // One row per request and a single worker: the load takes many
+  // sequential reads, so the first rows arrive well before the last
+  const size_t n = 1024;
+  TDynamicMatrix<double> m = makeAsyncMatrix(n);
+  saveBinary("test_tasyncio_rows.bin", m);
+  {
+    TAsyncOptions opts;
+    opts.chunkBytes = n * sizeof(double);
+    opts.queueDepth = 1;
+    opts.backend = TIoBackend::Threads;
+    TAsyncMatrixLoader<double> loader("test_tasyncio_rows.bin", opts);
+    double sum = 0;
+    bool sawPartial = loader.rowsReady() < loader.size();
+
+    for (size_t i = 0; i < loader.size(); i++) {
+      loader.waitRows(i + 1);
+      ASSERT_GE(loader.rowsReady(), i + 1);
+      sawPartial = sawPartial || loader.rowsReady() < loader.size();
+      sum += loader.row(i)[i];
+    }
+
+    EXPECT_TRUE(sawPartial);
+    EXPECT_EQ(n * (n - 1) / 2 * 1001.0, sum);
+    EXPECT_EQ(m, loader.get());
+  }
+  std::remove("test_tasyncio_rows.bin");
+}
+
+TEST(TAsyncIO, loader_row_rejects_rows_not_loaded_yet)
+{
+  TDynamicMatrix<double> m = makeAsyncMatrix(10);
+  saveBinary("test_tasyncio_row.bin", m);
+  {
+    TAsyncMatrixLoader<double> loader("test_tasyncio_row.bin", smallChunks(TIoBackend::Auto));
+
+    ASSERT_ANY_THROW(loader.row(10));
+    loader.waitRows(10);
+    EXPECT_EQ(m[9], loader.row(9));
+  }
+  std::remove("test_tasyncio_row.bin");
+}
+
+TEST(TAsyncIO, saver_writes_file_readable_by_synchronous_load)
+{
+  TDynamicMatrix<double> m = makeAsyncMatrix(30);
+  {
+    TAsyncMatrixSaver<double> saver("test_tasyncio_save.bin", m, smallChunks(TIoBackend::Auto));
+    saver.wait();
+  }
+  {
+    TAsyncMatrixSaver<double> saver("test_tasyncio_save_threads.bin", m, smallChunks(TIoBackend::Threads));
+    saver.wait();
+  }
+
+  EXPECT_EQ(m, loadBinaryMatrix<double>("test_tasyncio_save.bin"));
+  EXPECT_EQ(m, loadBinaryMatrix<double>("test_tasyncio_save_threads.bin"));
+  std::remove("test_tasyncio_save.bin");
+  std::remove("test_tasyncio_save_threads.bin");
+}
+
+TEST(TAsyncIO, loader_rejects_truncated_file)
+{
+  TDynamicMatrix<double> m = makeAsyncMatrix(8);
+  std::stringstream ss(std::ios::in | std::ios::out | std::ios::binary);
+  writeBinary(ss, m);
+  std::string bytes = ss.str();
+  {
+    std::ofstream f("test_tasyncio_short.bin", std::ios::binary);
+    f.write(bytes.data(), std::streamsize(bytes.size() - 8));
+  }
+
+  ASSERT_ANY_THROW(TAsyncMatrixLoader<double>("test_tasyncio_short.bin"));
+  std::remove("test_tasyncio_short.bin");
+}
+
+TEST(TAsyncIO, loader_and_saver_split_chunks_with_more_rows_than_iov_max)
+{
+  // 3000-byte rows: a default 4 MB chunk holds more than 1024 of them
+  const size_t n = 1500;
+  TDynamicMatrix<short> m(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      m[i][j] = short(i * 7 + j);
+  TAsyncOptions opts;
+  {
+    TAsyncMatrixSaver<short> saver("test_tasyncio_iov.bin", m, opts);
+    saver.wait();
+  }
+  {
+    TAsyncMatrixLoader<short> loader("test_tasyncio_iov.bin", opts);
+
+    EXPECT_EQ(m, loader.get());
+    EXPECT_EQ(n, loader.rowsReady());
+  }
+  std::remove("test_tasyncio_iov.bin");
+}
@@ -0,0 +1,116 @@
+#include "tcompressed.h"
+
+#include <gtest.h>
+#include <cstdio>
+#include <random>
+#include <sstream>
+
+TEST(TCompressed, lz_round_trip_handles_runs_and_random_bytes)
+{
+  std::vector<uint8_t> data(100000);
+  std::mt19937 gen(7);
+  for (size_t i = 0; i < data.size(); i++)
+    data[i] = i < 50000 ? uint8_t(i % 3) : uint8_t(gen());
+  std::vector<uint8_t> packed, unpacked(data.size());
+
+  lz::compress(data.data(), data.size(), packed);
+  lz::decompress(packed.data(), packed.size(), unpacked.data(), unpacked.size());
+
+  EXPECT_EQ(data, unpacked);
+  EXPECT_LT(packed.size(), 60000);
+}
+
+TEST(TCompressed, lz_rejects_corrupted_input)
+{
+  std::vector<uint8_t> data(1000, 42), packed, unpacked(data.size());
+  lz::compress(data.data(), data.size(), packed);
+
+  ASSERT_ANY_THROW(lz::decompress(packed.data(), packed.size() - 1, unpacked.data(), unpacked.size()));
+  ASSERT_ANY_THROW(lz::decompress(packed.data(), packed.size(), unpacked.data(), unpacked.size() - 1));
+}
+
+TEST(TCompressed, tile_filters_round_trip_and_shrink_smooth_data)
+{
+  std::vector<int64_t> v(4096);
+  for (size_t i = 0; i < v.size(); i++)
+    v[i] = 1000000 + int64_t(i) * 3;
+  std::vector<uint8_t> packed, buf;
+  std::vector<int64_t> back(v.size());
+
+  uint32_t filters = encodeTile(v.data(), v.size(), TCompressOptions(), packed);
+  decodeTile(packed.data(), packed.size(), filters, back.data(), back.size(), buf);
+
+  EXPECT_EQ(uint32_t(TileDelta | TileShuffle | TileLZ), filters);
+  EXPECT_EQ(v, back);
+  EXPECT_LT(packed.size() * 20, v.size() * sizeof(int64_t));
+}
+
+TEST(TCompressed, incompressible_tile_is_stored_raw)
+{
+  std::vector<uint32_t> v(1024);
+  std::mt19937 gen(1);
+  for (uint32_t& x : v)
+    x = gen();
+  std::vector<uint8_t> packed, buf;
+  std::vector<uint32_t> back(v.size());
+
+  uint32_t filters = encodeTile(v.data(), v.size(), TCompressOptions(), packed);
+  decodeTile(packed.data(), packed.size(), filters, back.data(), back.size(), buf);
+
+  EXPECT_EQ(0, filters);
+  EXPECT_EQ(v.size() * sizeof(uint32_t), packed.size());
+  EXPECT_EQ(v, back);
+}
+
+TEST(TCompressed, file_round_trip_with_partial_edge_tiles)
+{
+  const size_t n = 37;
+  TDynamicMatrix<double> m(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      m[i][j] = (i * n + j) % 5 == 0 ? 0.0 : i * 0.25 - j;
+  TCompressOptions opts;
+  opts.tile = 16;
+
+  saveCompressed("test_tcompressed.bin", m, opts);
+  TCompressedMatrix<double> c("test_tcompressed.bin");
+
+  EXPECT_EQ(n, c.size());
+  EXPECT_EQ(3, c.tileCount());
+  EXPECT_EQ(m, c.toMatrix());
+  EXPECT_EQ(m, loadCompressedMatrix<double>("test_tcompressed.bin"));
+  ASSERT_ANY_THROW(TCompressedMatrix<float>("test_tcompressed.bin"));
+  std::remove("test_tcompressed.bin");
+}
+
+TEST(TCompressed, reads_single_tile_without_decoding_others)
+{
+  const size_t n = 40;
+  TDynamicMatrix<int> m(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      m[i][j] = int(i * 100 + j);
+  TCompressOptions opts;
+  opts.tile = 32;
+  saveCompressed("test_tcompressed_tile.bin", m, opts);
+  TCompressedMatrix<int> c("test_tcompressed_tile.bin");
+  std::vector<int> t(8 * 32);
+
+  c.readTile(1, 0, t.data());
+
+  EXPECT_EQ(3200, t[0]);
+  EXPECT_EQ(3931, t[7 * 32 + 31]);
+  ASSERT_ANY_THROW(c.readTile(2, 0, t.data()));
+  EXPECT_LT(c.compressedBytes(), n * n * sizeof(int) / 4);
+  std::remove("test_tcompressed_tile.bin");
+}
+
+TEST(TCompressed, dense_binary_reader_rejects_compressed_file)
+{
+  TDynamicMatrix<int> m(4);
+  std::stringstream ss(std::ios::in | std::ios::out | std::ios::binary);
+
+  writeCompressed(ss, m);
+
+  ASSERT_ANY_THROW(readBinaryMatrix<int>(ss));
+}
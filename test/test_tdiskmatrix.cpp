@@ -0,0 +1,142 @@
+#include "tdiskmatrix.h"
+
+#include <gtest.h>
+#include <cstdio>
+
+static TDynamicMatrix<double> makeDiskTestMatrix(size_t n, double shift)
+{
+  TDynamicMatrix<double> m(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      m[i][j] = double((i * 7 + j * 3) % 11) - shift;
+  return m;
+}
+
+TEST(TDiskMatrix, round_trips_matrix_with_partial_edge_tiles)
+{
+  TTileCache cache(1 << 20);
+  TDynamicMatrix<double> m = makeDiskTestMatrix(10, 2.0);
+  {
+    TDiskMatrix<double> d = TDiskMatrix<double>::fromMatrix("test_tdiskmatrix_a.bin", m, 4, cache);
+
+    EXPECT_EQ(3, d.tileCount());
+    EXPECT_EQ(m[9][5], d.get(9, 5));
+    EXPECT_EQ(m, d.toMatrix());
+  }
+  std::remove("test_tdiskmatrix_a.bin");
+}
+
+TEST(TDiskMatrix, changes_persist_in_file_after_reopen)
+{
+  TTileCache cache(1 << 20);
+  {
+    TDiskMatrix<int> d("test_tdiskmatrix_b.bin", 5, 2, cache);
+    d.set(4, 3, 17);
+    d.flush();
+  }
+  {
+    TDiskMatrix<int> d("test_tdiskmatrix_b.bin", cache);
+
+    EXPECT_EQ(5, d.size());
+    EXPECT_EQ(2, d.tileSize());
+    EXPECT_EQ(17, d.get(4, 3));
+    EXPECT_EQ(0, d.get(3, 4));
+  }
+  std::remove("test_tdiskmatrix_b.bin");
+}
+
+TEST(TDiskMatrix, cache_stays_within_budget)
+{
+  const size_t tileBytes = 4 * 4 * sizeof(double);
+  TTileCache cache(3 * tileBytes);
+  {
+    TDiskMatrix<double> d = TDiskMatrix<double>::fromMatrix("test_tdiskmatrix_c.bin", makeDiskTestMatrix(16, 0), 4, cache);
+    cache.resetStats();
+
+    d.toMatrix();
+    d.get(15, 15);
+
+    EXPECT_LE(cache.bytesCached(), 3 * tileBytes);
+    EXPECT_EQ(16, cache.stats().reads);
+    EXPECT_EQ(1, cache.stats().hits);
+  }
+  std::remove("test_tdiskmatrix_c.bin");
+}
+
+TEST(TDiskMatrix, gemm_matches_in_memory_product_under_small_budget)
+{
+  const size_t tileBytes = 3 * 3 * sizeof(double);
+  TTileCache cache(8 * tileBytes);
+  TDynamicMatrix<double> a = makeDiskTestMatrix(11, 3.0), b = makeDiskTestMatrix(11, 5.0), c = makeDiskTestMatrix(11, 1.0);
+  {
+    TDiskMatrix<double> da = TDiskMatrix<double>::fromMatrix("test_tdiskmatrix_da.bin", a, 3, cache);
+    TDiskMatrix<double> db = TDiskMatrix<double>::fromMatrix("test_tdiskmatrix_db.bin", b, 3, cache);
+    TDiskMatrix<double> dc = TDiskMatrix<double>::fromMatrix("test_tdiskmatrix_dc.bin", c, 3, cache);
+
+    gemm(2.0, da, db, -1.0, dc);
+
+    EXPECT_EQ(a * b * 2.0 - c, dc.toMatrix());
+    EXPECT_LE(cache.bytesCached(), 8 * tileBytes);
+    ASSERT_ANY_THROW(gemm(1.0, da, db, 0.0, da));
+  }
+  std::remove("test_tdiskmatrix_da.bin");
+  std::remove("test_tdiskmatrix_db.bin");
+  std::remove("test_tdiskmatrix_dc.bin");
+}
+
+TEST(TDiskMatrix, gemv_and_add_match_in_memory_results)
+{
+  TTileCache cache(1 << 20);
+  TDynamicMatrix<double> a = makeDiskTestMatrix(9, 4.0), b = makeDiskTestMatrix(9, 1.0);
+  TDynamicVector<double> x(9), y(9);
+  for (size_t i = 0; i < 9; i++)
+    x[i] = double(i) - 4.0;
+  {
+    TDiskMatrix<double> da = TDiskMatrix<double>::fromMatrix("test_tdiskmatrix_ga.bin", a, 4, cache);
+    TDiskMatrix<double> db = TDiskMatrix<double>::fromMatrix("test_tdiskmatrix_gb.bin", b, 4, cache);
+
+    gemv(1.0, da, x, 0.0, y);
+    add(da, db, db);
+
+    EXPECT_EQ(a * x, y);
+    EXPECT_EQ(a + b, db.toMatrix());
+  }
+  std::remove("test_tdiskmatrix_ga.bin");
+  std::remove("test_tdiskmatrix_gb.bin");
+}
+
+TEST(TDiskMatrix, gemv_with_zero_alpha_does_not_read_tiles)
+{
+  TTileCache cache(1 << 20);
+  TDynamicMatrix<double> a = makeDiskTestMatrix(9, 4.0);
+  a[5][6] = std::numeric_limits<double>::quiet_NaN();
+  TDynamicVector<double> x(9), y(9), expected(9);
+  x[2] = std::numeric_limits<double>::infinity();
+  for (size_t i = 0; i < 9; i++) {
+    y[i] = double(i);
+    expected[i] = 2.0 * double(i);
+  }
+  {
+    TDiskMatrix<double> da = TDiskMatrix<double>::fromMatrix("test_tdiskmatrix_za.bin", a, 4, cache);
+    cache.resetStats();
+
+    gemv(0.0, da, x, 2.0, y);
+
+    EXPECT_EQ(expected, y);
+    EXPECT_EQ(0, cache.stats().reads);
+    EXPECT_EQ(0, cache.stats().hits);
+  }
+  std::remove("test_tdiskmatrix_za.bin");
+}
+
+TEST(TDiskMatrix, throws_on_mismatched_tile_sizes)
+{
+  TTileCache cache(1 << 20);
+  {
+    TDiskMatrix<double> a("test_tdiskmatrix_ta.bin", 8, 4, cache), b("test_tdiskmatrix_tb.bin", 8, 2, cache);
+
+    ASSERT_ANY_THROW(add(a, b, a));
+  }
+  std::remove("test_tdiskmatrix_ta.bin");
+  std::remove("test_tdiskmatrix_tb.bin");
+}
@@ -0,0 +1,345 @@
+#include "tdistributed.h"
+
+#include <gtest.h>
+#include <cmath>
+#include <functional>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#endif
+
+static TDynamicMatrix<long long> makeDistributedMatrix(size_t n, long long seed)
+{
+  TDynamicMatrix<long long> m(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      m[i][j] = (long long)((i * 7 + j * 3 + seed) % 11) - 5;
+  return m;
+}
+
+static TDynamicMatrix<long long> referenceProduct(const TDynamicMatrix<long long>& a, const TDynamicMatrix<long long>& b)
+{
+  TDynamicMatrix<long long> c(a.size());
+  gemm(1LL, a, b, 0LL, c);
+  return c;
+}
+
+#if !defined(_WIN32)
+// Runs f(transport) for every rank of a local group on its own thread
+static void runGroup(size_t p, const std::function<void(TTransport&)>& f)
+{
+  auto group = TSocketTransport::localGroup(p);
+  std::vector<std::thread> threads;
+  for (size_t r = 0; r < p; r++)
+    threads.emplace_back([&, r] { f(*group[r]); });
+  for (auto& th : threads)
+    th.join();
+}
+
+TEST(TDistributed, process_grid_is_close_to_square)
+{
+  EXPECT_EQ(2, TProcessGrid::square(4).rows);
+  EXPECT_EQ(2, TProcessGrid::square(6).rows);
+  EXPECT_EQ(3, TProcessGrid::square(6).cols);
+  EXPECT_EQ(1, TProcessGrid::square(7).rows);
+}
+
+TEST(TDistributed, broadcast_reaches_every_member_of_group)
+{
+  const size_t p = 5;
+  std::vector<int> got(p, 0);
+
+  runGroup(p, [&](TTransport& t) {
+    std::vector<size_t> group = { 4, 0, 2, 1, 3 };
+    int val = t.rank() == 2 ? 42 : 0;
+    broadcast(t, group, 2, &val, sizeof(val));
+    got[t.rank()] = val;
+  });
+
+  EXPECT_EQ(std::vector<int>(p, 42), got);
+}
+
+TEST(TDistributed, scatter_then_gather_restores_matrix)
+{
+  const size_t n = 13;
+  TDynamicMatrix<long long> m = makeDistributedMatrix(n, 1), res;
+
+  runGroup(6, [&](TTransport& t) {
+    TDistributedMatrix<long long> d(n, TProcessGrid::square(6), t.rank());
+    d.scatter(t, m);
+    EXPECT_EQ(m[d.rowBegin()][d.colBegin()], d.at(d.rowBegin(), d.colBegin()));
+    TDynamicMatrix<long long> g = d.gather(t);
+    if (t.rank() == 0)
+      res = g;
+  });
+
+  EXPECT_EQ(m, res);
+}
+
+TEST(TDistributed, summa_matches_serial_product_on_uneven_grid)
+{
+  const size_t n = 17;
+  TDynamicMatrix<long long> a = makeDistributedMatrix(n, 2), b = makeDistributedMatrix(n, 5), res;
+
+  runGroup(6, [&](TTransport& t) {
+    TProcessGrid g = TProcessGrid::square(6);
+    TDistributedMatrix<long long> da(n, g, t.rank()), db(n, g, t.rank()), dc(n, g, t.rank());
+    da.scatter(t, a);
+    db.scatter(t, b);
+    gemm(t, 1LL, da, db, 0LL, dc, 4);
+    TDynamicMatrix<long long> c = dc.gather(t);
+    if (t.rank() == 0)
+      res = c;
+  });
+
+  EXPECT_EQ(referenceProduct(a, b), res);
+}
+
+TEST(TDistributed, summa_applies_alpha_and_beta)
+{
+  const size_t n = 10;
+  TDynamicMatrix<double> a(n), b(n), c(n), res;
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++) {
+      a[i][j] = double(i + j);
+      b[i][j] = double(int(i) - int(j));
+      c[i][j] = 1.0;
+    }
+  TDynamicMatrix<double> expected(n);
+  gemm(2.0, a, b, 0.0, expected);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      expected[i][j] -= 3.0;
+
+  runGroup(4, [&](TTransport& t) {
+    TProcessGrid g = TProcessGrid::square(4);
+    TDistributedMatrix<double> da(n, g, t.rank()), db(n, g, t.rank()), dc(n, g, t.rank());
+    da.fill([&](size_t i, size_t j) { return a[i][j]; });
+    db.fill([&](size_t i, size_t j) { return b[i][j]; });
+    dc.fill([](size_t, size_t) { return 1.0; });
+    gemm(t, 2.0, da, db, -3.0, dc);
+    TDynamicMatrix<double> r = dc.gather(t);
+    if (t.rank() == 0)
+      res = r;
+  });
+
+  EXPECT_EQ(expected, res);
+}
+
+TEST(TDistributed, summa_rejects_aliased_output)
+{
+  runGroup(1, [](TTransport& t) {
+    TDistributedMatrix<int> a(3, TProcessGrid::square(1), 0), b(3, TProcessGrid::square(1), 0);
+    EXPECT_THROW(gemm(t, 1, a, b, 0, a), std::invalid_argument);
+  });
+}
+
+TEST(TDistributed, summa_runs_across_processes)
+{
+  const size_t n = 24, p = 4;
+  TDynamicMatrix<long long> a = makeDistributedMatrix(n, 3), b = makeDistributedMatrix(n, 4);
+  auto group = TSocketTransport::localGroup(p);
+  std::vector<pid_t> children;
+  for (size_t r = 1; r < p; r++) {
+    pid_t pid = fork();
+    ASSERT_NE(-1, pid);
+    if (pid == 0) {
+      int code = 0;
+      try {
+        TProcessGrid g = TProcessGrid::square(p);
+        TDistributedMatrix<long long> da(n, g, r), db(n, g, r), dc(n, g, r);
+        da.scatter(*group[r], a);
+        db.scatter(*group[r], b);
+        gemm(*group[r], 1LL, da, db, 0LL, dc, 5);
+        dc.gather(*group[r]);
+      } catch (...) {
+        code = 1;
+      }
+      _exit(code);
+    }
+    children.push_back(pid);
+  }
+
+  TProcessGrid g = TProcessGrid::square(p);
+  TDistributedMatrix<long long> da(n, g, 0), db(n, g, 0), dc(n, g, 0);
+  da.scatter(*group[0], a);
+  db.scatter(*group[0], b);
+  gemm(*group[0], 1LL, da, db, 0LL, dc, 5);
+  TDynamicMatrix<long long> res = dc.gather(*group[0]);
+
+  for (pid_t pid : children) {
+    int status = 0;
+    waitpid(pid, &status, 0);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  }
+  EXPECT_EQ(referenceProduct(a, b), res);
+}
+#endif
+
+#if !defined(_WIN32)
+static TDynamicMatrix<double> makeBandMatrix(size_t n, size_t band)
+{
+  TDynamicMatrix<double> m(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      if (i <= j + band && j <= i + band)
+        m[i][j] = 1.0 / (i + 2 * j + 1);
+  return m;
+}
+
+static TDynamicVector<double> distributedMatvec(size_t p, const TDynamicMatrix<double>& m, const TDynamicVector<double>& x,
+                                                THaloMode mode = THaloMode::Sparse, size_t* halo = nullptr)
+{
+  TDynamicVector<double> res;
+  runGroup(p, [&](TTransport& t) {
+    TDistributedMatrix<double> a(m.size(), TProcessGrid{ p, 1 }, t.rank());
+    TDistributedVector<double> dx(m.size(), p, t.rank()), dy(m.size(), p, t.rank());
+    a.scatter(t, m);
+    dx.scatter(t, x);
+    THaloPlan plan(t, a, mode);
+    gemv(t, plan, 1.0, a, dx, 0.0, dy);
+    TDynamicVector<double> y = dy.gather(t);
+    if (t.rank() == 0) {
+      res = y;
+      if (halo)
+        *halo = plan.haloSize();
+    }
+  });
+  return res;
+}
+
+TEST(TDistributed, dense_matvec_is_identical_to_operator_multiply)
+{
+  const size_t n = 101;
+  TDynamicMatrix<double> m(n);
+  TDynamicVector<double> x(n);
+  for (size_t i = 0; i < n; i++) {
+    x[i] = 1.0 / (i + 3);
+    for (size_t j = 0; j < n; j++)
+      m[i][j] = std::sin(double(i * n + j));
+  }
+
+  EXPECT_EQ(m * x, distributedMatvec(4, m, x));
+}
+
+TEST(TDistributed, band_matvec_exchanges_only_halo)
+{
+  const size_t n = 64, band = 2;
+  TDynamicMatrix<double> m = makeBandMatrix(n, band);
+  TDynamicVector<double> x(n);
+  for (size_t i = 0; i < n; i++)
+    x[i] = 0.5 - double(i % 7);
+  size_t halo = 0;
+
+  EXPECT_EQ(m * x, distributedMatvec(4, m, x, THaloMode::Sparse, &halo));
+  EXPECT_EQ(band, halo); // Rank 0 owns the first block and only needs its right neighbour's edge
+}
+
+TEST(TDistributed, band_matvec_propagates_nan_and_inf_like_operator_multiply)
+{
+  const size_t n = 64, band = 2;
+  TDynamicMatrix<double> m = makeBandMatrix(n, band);
+  TDynamicVector<double> x(n);
+  for (size_t i = 0; i < n; i++)
+    x[i] = 0.5 - double(i % 7);
+  TDynamicVector<double> xInf = x;
+  x[40] = std::nan("");
+  xInf[40] = std::numeric_limits<double>::infinity();
+  size_t halo = 0;
+
+  // 0 * NaN and 0 * Inf are NaN, so rows outside the band around column 40 are NaN
+  // in the single-process product too, although their ranks never need x[40]
+  TDynamicVector<double> expected = m * x, res = distributedMatvec(4, m, x, THaloMode::Sparse, &halo);
+  TDynamicVector<double> expectedInf = m * xInf, resInf = distributedMatvec(4, m, xInf);
+
+  EXPECT_EQ(band, halo);
+  ASSERT_EQ(n, res.size());
+  ASSERT_EQ(n, resInf.size());
+  for (size_t i = 0; i < n; i++) {
+    ASSERT_TRUE(std::isnan(expected[i]));
+    EXPECT_TRUE(std::isnan(res[i])) << "row " << i;
+    if (std::isnan(expectedInf[i]))
+      EXPECT_TRUE(std::isnan(resInf[i])) << "row " << i;
+    else
+      EXPECT_EQ(expectedInf[i], resInf[i]) << "row " << i;
+  }
+  EXPECT_TRUE(std::isinf(expectedInf[40]));
+}
+
+TEST(TDistributed, full_halo_mode_sends_every_element)
+{
+  const size_t n = 64;
+  TDynamicMatrix<double> m = makeBandMatrix(n, 2);
+  TDynamicVector<double> x(n);
+  for (size_t i = 0; i < n; i++)
+    x[i] = double(i) - 20.0;
+  size_t halo = 0;
+
+  EXPECT_EQ(m * x, distributedMatvec(4, m, x, THaloMode::Full, &halo));
+  EXPECT_EQ(n - n / 4, halo);
+}
+
+TEST(TDistributed, matvec_applies_alpha_and_beta_like_gemv)
+{
+  const size_t n = 30;
+  TDynamicMatrix<double> m = makeBandMatrix(n, 5);
+  TDynamicVector<double> x(n), y0(n);
+  for (size_t i = 0; i < n; i++) {
+    x[i] = double(i) / 3;
+    y0[i] = 1.0 - double(i);
+  }
+  TDynamicVector<double> expected = y0, res;
+  gemv(2.0, m, x, -0.5, expected);
+
+  runGroup(3, [&](TTransport& t) {
+    TDistributedMatrix<double> a(n, TProcessGrid{ 3, 1 }, t.rank());
+    TDistributedVector<double> dx(n, 3, t.rank()), dy(n, 3, t.rank());
+    a.fill([&](size_t i, size_t j) { return m[i][j]; });
+    dx.fill([&](size_t i) { return x[i]; });
+    dy.fill([&](size_t i) { return y0[i]; });
+    THaloPlan plan(t, a);
+    gemv(t, plan, 2.0, a, dx, -0.5, dy);
+    TDynamicVector<double> y = dy.gather(t);
+    if (t.rank() == 0)
+      res = y;
+  });
+
+  EXPECT_EQ(expected, res);
+}
+
+TEST(TDistributed, matvec_with_zero_alpha_ignores_x_like_gemv)
+{
+  const size_t n = 20;
+  TDynamicMatrix<double> m = makeBandMatrix(n, 3);
+  TDynamicVector<double> x(n), y0(n);
+  for (size_t i = 0; i < n; i++)
+    y0[i] = double(i) - 4.0;
+  x[7] = std::nan("");
+  TDynamicVector<double> expected = y0, res;
+  gemv(0.0, m, x, 3.0, expected);
+
+  runGroup(3, [&](TTransport& t) {
+    TDistributedMatrix<double> a(n, TProcessGrid{ 3, 1 }, t.rank());
+    TDistributedVector<double> dx(n, 3, t.rank()), dy(n, 3, t.rank());
+    a.fill([&](size_t i, size_t j) { return m[i][j]; });
+    dx.fill([&](size_t i) { return x[i]; });
+    dy.fill([&](size_t i) { return y0[i]; });
+    THaloPlan plan(t, a);
+    gemv(t, plan, 0.0, a, dx, 3.0, dy);
+    TDynamicVector<double> y = dy.gather(t);
+    if (t.rank() == 0)
+      res = y;
+  });
+
+  EXPECT_EQ(expected, res);
+}
+
+TEST(TDistributed, halo_plan_requires_row_distribution)
+{
+  runGroup(4, [](TTransport& t) {
+    TDistributedMatrix<double> a(8, TProcessGrid::square(4), t.rank());
+    EXPECT_THROW(THaloPlan(t, a), std::invalid_argument);
+  });
+}
+#endif
@@ -0,0 +1,195 @@
+#include "texchange.h"
+
+#include <gtest.h>
+#include <cstdio>
+#include <sstream>
+
+static TDynamicMatrix<double> makeExchangeMatrix(size_t n)
+{
+  TDynamicMatrix<double> m(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      m[i][j] = (i + 1) / 3.0 - j;
+  return m;
+}
+
+// Bytes of an NPY file with the given header dictionary and raw data
+static std::string npyBytes(const std::string& dict, const std::string& data)
+{
+  std::string header = dict;
+  header.append((64 - (10 + header.size() + 1) % 64) % 64, ' ');
+  header.push_back('\n');
+  std::string res("\x93NUMPY\x01\x00", 8);
+  res.push_back(char(header.size() & 0xFF));
+  res.push_back(char(header.size() >> 8));
+  return res + header + data;
+}
+
+TEST(TExchange, npy_header_matches_numpy_layout)
+{
+  TDynamicMatrix<int32_t> m(2);
+  std::ostringstream out(std::ios::out | std::ios::binary);
+
+  writeNpy(out, m);
+
+  std::string bytes = out.str();
+  ASSERT_EQ(128 + 4 * sizeof(int32_t), bytes.size());
+  EXPECT_EQ(std::string("\x93NUMPY\x01\x00\x76\x00", 10), bytes.substr(0, 10));
+  std::string dict = "{'descr': '<i4', 'fortran_order': False, 'shape': (2, 2), }";
+  EXPECT_EQ(dict, bytes.substr(10, dict.size()));
+  EXPECT_EQ('\n', bytes[127]);
+}
+
+TEST(TExchange, npy_round_trip_preserves_matrix_and_vector)
+{
+  TDynamicMatrix<double> m = makeExchangeMatrix(5);
+  TDynamicVector<float> v(3);
+  v[0] = 1.5f; v[1] = -2.0f; v[2] = 0.25f;
+  std::stringstream ms(std::ios::in | std::ios::out | std::ios::binary);
+  std::stringstream vs(std::ios::in | std::ios::out | std::ios::binary);
+
+  writeNpy(ms, m);
+  writeNpy(vs, v);
+
+  EXPECT_EQ(m, readNpyMatrix<double>(ms));
+  EXPECT_EQ(v, readNpyVector<float>(vs));
+}
+
+TEST(TExchange, npy_read_converts_type_byte_order_and_fortran_order)
+{
+  // Big-endian int16 matrix [[1, 2], [3, 4]] stored column by column
+  std::string data("\x00\x01\x00\x03\x00\x02\x00\x04", 8);
+  std::istringstream in(npyBytes("{'descr': '>i2', 'fortran_order': True, 'shape': (2, 2), }", data),
+                        std::ios::in | std::ios::binary);
+
+  TDynamicMatrix<double> m = readNpyMatrix<double>(in);
+
+  EXPECT_EQ(1.0, m[0][0]);
+  EXPECT_EQ(2.0, m[0][1]);
+  EXPECT_EQ(3.0, m[1][0]);
+  EXPECT_EQ(4.0, m[1][1]);
+}
+
+TEST(TExchange, npy_read_rejects_non_square_and_unsupported_dtype)
+{
+  std::istringstream rect(npyBytes("{'descr': '<i4', 'fortran_order': False, 'shape': (2, 3), }", std::string(24, '\0')),
+                          std::ios::in | std::ios::binary);
+  std::istringstream complex(npyBytes("{'descr': '<c16', 'fortran_order': False, 'shape': (1, 1), }", std::string(16, '\0')),
+                             std::ios::in | std::ios::binary);
+
+  ASSERT_ANY_THROW(readNpyMatrix<int>(rect));
+  ASSERT_ANY_THROW(readNpyMatrix<double>(complex));
+}
+
+TEST(TExchange, mapped_npy_matrix_is_zero_copy)
+{
+  TDynamicMatrix<double> m = makeExchangeMatrix(4);
+  saveNpy("test_texchange_mapped.npy", m);
+  {
+    TNpyMappedMatrix<double> mapped("test_texchange_mapped.npy");
+
+    EXPECT_EQ(m, mapped.matrix());
+    EXPECT_FALSE(mapped.matrix()[0].owns());
+    ASSERT_ANY_THROW(TNpyMappedMatrix<float>("test_texchange_mapped.npy"));
+  }
+  EXPECT_EQ(m, loadNpyMatrix<double>("test_texchange_mapped.npy"));
+  std::remove("test_texchange_mapped.npy");
+}
+
+TEST(TExchange, assigned_expression_is_written_to_writable_mapped_npy_matrix)
+{
+  TDynamicMatrix<double> m = makeExchangeMatrix(4);
+  saveNpy("test_texchange_assign.npy", TDynamicMatrix<double>(4));
+  {
+    TNpyMappedMatrix<double> mapped("test_texchange_assign.npy", true);
+    mapped.matrix() = m * m;
+
+    EXPECT_FALSE(mapped.matrix()[0].owns());
+  }
+  TDynamicMatrix<double> reloaded = loadNpyMatrix<double>("test_texchange_assign.npy");
+  std::remove("test_texchange_assign.npy");
+
+  EXPECT_EQ(m * m, reloaded);
+}
+
+TEST(TExchange, matrix_market_coordinate_writes_only_nonzeros)
+{
+  TDynamicMatrix<double> m(100);
+  m[3][7] = 0.1;
+  m[99][0] = -2.5;
+  std::stringstream ss;
+
+  writeMatrixMarket(ss, m);
+
+  EXPECT_EQ("%%MatrixMarket matrix coordinate real general\n100 100 2\n4 8 0.10000000000000001\n100 1 -2.5\n", ss.str());
+  EXPECT_EQ(m, readMatrixMarket<double>(ss));
+}
+
+TEST(TExchange, matrix_market_array_round_trip_is_exact)
+{
+  TDynamicMatrix<double> m = makeExchangeMatrix(6);
+  std::stringstream ss;
+
+  writeMatrixMarket(ss, m, TMatrixMarketFormat::Array);
+
+  EXPECT_EQ(m, readMatrixMarket<double>(ss));
+}
+
+TEST(TExchange, matrix_market_expands_symmetric_entries)
+{
+  std::istringstream in("%%MatrixMarket matrix coordinate integer symmetric\n"
+                        "% comment\n"
+                        "3 3 2\n"
+                        "2 1 5\n"
+                        "3 3 7\n");
+
+  TDynamicMatrix<int> m = readMatrixMarket<int>(in);
+
+  EXPECT_EQ(5, m[1][0]);
+  EXPECT_EQ(5, m[0][1]);
+  EXPECT_EQ(7, m[2][2]);
+  EXPECT_EQ(0, m[0][0]);
+}
+
+TEST(TExchange, matrix_market_reads_skew_symmetric_array)
+{
+  std::istringstream in("%%MatrixMarket matrix array real skew-symmetric\n3 3\n1\n2\n3\n");
+
+  TDynamicMatrix<double> m = readMatrixMarket<double>(in);
+
+  EXPECT_EQ(1.0, m[1][0]);
+  EXPECT_EQ(-1.0, m[0][1]);
+  EXPECT_EQ(2.0, m[2][0]);
+  EXPECT_EQ(3.0, m[2][1]);
+  EXPECT_EQ(-3.0, m[1][2]);
+}
+
+TEST(TExchange, matrix_market_reader_streams_pattern_entries)
+{
+  std::istringstream in("%%MatrixMarket matrix coordinate pattern general\n4 5 2\n1 5\n4 1\n");
+  TMatrixMarketReader<int> reader(in);
+  size_t i, j, count = 0;
+  int val;
+
+  while (reader.next(i, j, val)) {
+    EXPECT_EQ(1, val);
+    count++;
+  }
+
+  EXPECT_EQ(4, reader.rows());
+  EXPECT_EQ(5, reader.cols());
+  EXPECT_EQ(2, count);
+}
+
+TEST(TExchange, matrix_market_reports_error_position)
+{
+  std::istringstream in("%%MatrixMarket matrix coordinate real general\n2 2 2\n1 1 1.0\n2 3 4.0\n");
+
+  try {
+    readMatrixMarket<double>(in);
+    FAIL();
+  } catch (const TTextParseError& e) {
+    EXPECT_EQ(4, e.line());
+    EXPECT_EQ(1, e.column());
+  }
+}
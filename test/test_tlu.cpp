@@ -0,0 +1,124 @@
+#include "tlu.h"
+
+#include <gtest.h>
+#include <cmath>
+
+static TDynamicMatrix<double> makeLuMatrix(size_t n)
+{
+  TDynamicMatrix<double> m(n);
+  unsigned state = 12345;
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++) {
+      state = state * 1103515245u + 12345u;
+      m[i][j] = double(state >> 8) / double(1u << 24) - 0.5;
+    }
+  return m;
+}
+
+static double maxDiff(const TDynamicMatrix<double>& a, const TDynamicMatrix<double>& b)
+{
+  double res = 0;
+  for (size_t i = 0; i < a.size(); i++)
+    for (size_t j = 0; j < a.size(); j++)
+      res = std::max(res, std::abs(a[i][j] - b[i][j]));
+  return res;
+}
+
+TEST(TLU, solve_gives_small_residual)
+{
+  const size_t n = 150;
+  TDynamicMatrix<double> a = makeLuMatrix(n);
+  TDynamicVector<double> b(n);
+  for (size_t i = 0; i < n; i++)
+    b[i] = double(i % 5) - 2;
+
+  TDynamicVector<double> x = TLU<double>(a, 16).solve(b);
+
+  TDynamicVector<double> r = a * x;
+  for (size_t i = 0; i < n; i++)
+    EXPECT_NEAR(b[i], r[i], 1e-9);
+}
+
+TEST(TLU, pivots_past_zero_diagonal)
+{
+  TDynamicMatrix<double> a(3);
+  a[0][1] = 2; a[1][0] = 1; a[1][2] = 1; a[2][2] = 4; a[2][0] = 3;
+  TDynamicVector<double> b(3);
+  b[0] = 2; b[1] = 2; b[2] = 7;
+
+  TDynamicVector<double> x = solve(a, b);
+
+  EXPECT_NEAR(1.0, x[0], 1e-14);
+  EXPECT_NEAR(1.0, x[1], 1e-14);
+  EXPECT_NEAR(1.0, x[2], 1e-14);
+}
+
+TEST(TLU, determinant_accounts_for_row_swaps)
+{
+  TDynamicMatrix<double> p(2);
+  p[0][1] = 1; p[1][0] = 1;
+  TDynamicMatrix<double> t(4);
+  for (size_t i = 0; i < 4; i++)
+    for (size_t j = i; j < 4; j++)
+      t[i][j] = double(i + 1);
+
+  EXPECT_EQ(-1.0, determinant(p));
+  EXPECT_NEAR(24.0, determinant(t), 1e-12);
+}
+
+TEST(TLU, blocked_factors_match_unblocked)
+{
+  TDynamicMatrix<double> a = makeLuMatrix(70);
+
+  TLU<double> unblocked(a, 70), blocked(a, 8);
+
+  EXPECT_EQ(unblocked.pivots(), blocked.pivots());
+  EXPECT_LT(maxDiff(unblocked.factors(), blocked.factors()), 1e-10);
+}
+
+TEST(TLU, many_right_hand_sides_match_single_solves)
+{
+  const size_t n = 40;
+  TDynamicMatrix<double> a = makeLuMatrix(n), b(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      b[i][j] = double(i) - 2.0 * double(j);
+  TLU<double> lu(a, 12);
+
+  TDynamicMatrix<double> x = lu.solve(b);
+
+  for (size_t c = 0; c < n; c += 13) {
+    TDynamicVector<double> col(n);
+    for (size_t i = 0; i < n; i++)
+      col[i] = b[i][c];
+    TDynamicVector<double> xc = lu.solve(col);
+    for (size_t i = 0; i < n; i++)
+      EXPECT_NEAR(xc[i], x[i][c], 1e-10);
+  }
+}
+
+TEST(TLU, inverse_times_matrix_is_identity)
+{
+  const size_t n = 60;
+  TDynamicMatrix<double> a = makeLuMatrix(n), e(n);
+  for (size_t i = 0; i < n; i++)
+    e[i][i] = 1;
+
+  TDynamicMatrix<double> inv = inverse(a);
+
+  EXPECT_LT(maxDiff(a * inv, e), 1e-9);
+}
+
+TEST(TLU, singular_matrix_has_zero_determinant_and_cannot_be_solved)
+{
+  TDynamicMatrix<double> a = makeLuMatrix(10);
+  a[7] = a[2];
+  TDynamicMatrix<double> z(5);
+
+  TLU<double> lu(z);
+
+  EXPECT_TRUE(lu.singular());
+  EXPECT_EQ(0.0, lu.determinant());
+  ASSERT_THROW(lu.solve(TDynamicVector<double>(5)), std::runtime_error);
+  EXPECT_LT(std::abs(determinant(a)), 1e-12);
+}
@@ -1,6 +1,7 @@
 #include "tmatrix.h"
 
 #include <gtest.h>
+#include <sstream>
 
 TEST(TDynamicMatrix, can_create_matrix_with_positive_length)
 {
@@ -242,3 +243,583 @@ TEST(TDynamicMatrix, cant_subtract_matrixes_with_not_equal_size) {
 }
 
 
+
+TEST(TDynamicMatrix, can_multiply_matrices_with_equal_size) {
+    TDynamicMatrix<int> m1(2), m2(2);
+    m1[0][0] = 1; m1[0][1] = 2;
+    m1[1][0] = 3; m1[1][1] = 4;
+
+    m2[0][0] = 5; m2[0][1] = 6;
+    m2[1][0] = 7; m2[1][1] = 8;
+
+    TDynamicMatrix<int> result = m1 * m2;
+
+    EXPECT_EQ(result[0][0], 19);
+    EXPECT_EQ(result[0][1], 22);
+    EXPECT_EQ(result[1][0], 43);
+    EXPECT_EQ(result[1][1], 50);
+}
+
+TEST(TDynamicMatrix, can_multiply_matrix_by_vector) {
+    TDynamicMatrix<int> m(2);
+    m[0][0] = 1; m[0][1] = 2;
+    m[1][0] = 3; m[1][1] = 4;
+    TDynamicVector<int> v(2);
+    v[0] = 5; v[1] = 6;
+
+    TDynamicVector<int> res = m * v;
+
+    EXPECT_EQ(res[0], 17);
+    EXPECT_EQ(res[1], 39);
+}
+
+TEST(TDynamicMatrix, gemm_accumulates_into_output) {
+    TDynamicMatrix<int> a(2), b(2), c(2);
+    a[0][0] = 1; a[0][1] = 2;
+    a[1][0] = 3; a[1][1] = 4;
+    b[0][0] = 5; b[0][1] = 6;
+    b[1][0] = 7; b[1][1] = 8;
+    c[0][0] = 1; c[0][1] = 1;
+    c[1][0] = 1; c[1][1] = 1;
+
+    gemm(2, a, b, 3, c);
+
+    EXPECT_EQ(c[0][0], 41);
+    EXPECT_EQ(c[0][1], 47);
+    EXPECT_EQ(c[1][0], 89);
+    EXPECT_EQ(c[1][1], 103);
+}
+
+TEST(TDynamicMatrix, gemm_with_zero_beta_ignores_old_output) {
+    TDynamicMatrix<double> a(2), b(2), c(2);
+    a[0][0] = 1; a[1][1] = 1;
+    b[0][1] = 2; b[1][0] = 3;
+    c[0][0] = std::numeric_limits<double>::quiet_NaN();
+
+    gemm(1.0, a, b, 0.0, c);
+
+    EXPECT_EQ(c, b);
+}
+
+TEST(TDynamicMatrix, gemv_with_zero_alpha_ignores_matrix_and_vector) {
+    TThreadPool pool(3);
+    for (size_t n : { size_t(2), size_t(TMATRIX_SMALL_KERNEL_MAX + 5) }) {
+        TDynamicMatrix<double> a(n);
+        TDynamicVector<double> x(n), y(n), z(n), expected(n);
+        a[0][0] = std::numeric_limits<double>::quiet_NaN();
+        a[n - 1][1] = std::numeric_limits<double>::infinity();
+        x[1] = std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < n; i++) {
+            y[i] = double(i);
+            expected[i] = 2.0 * double(i);
+        }
+        TDynamicVector<double> yp(y), yv(y);
+
+        gemv(0.0, a, x, 2.0, y);
+        gemv(pool, 0.0, a, x, 2.0, yp);
+        gemv(0.0, a.view(), x, 2.0, yv);
+        gemv(0.0, a, x, 0.0, z);
+
+        EXPECT_EQ(expected, y);
+        EXPECT_EQ(expected, yp);
+        EXPECT_EQ(expected, yv);
+        EXPECT_EQ(TDynamicVector<double>(n), z);
+    }
+}
+
+TEST(TDynamicMatrix, gemm_throws_when_output_aliases_input) {
+    TDynamicMatrix<int> a(2), b(2);
+    ASSERT_ANY_THROW(gemm(1, a, b, 0, a));
+}
+
+TEST(TDynamicMatrix, gemm_throws_when_sizes_differ) {
+    TDynamicMatrix<int> a(2), b(3), c(2);
+    ASSERT_ANY_THROW(gemm(1, a, b, 0, c));
+}
+
+TEST(TDynamicMatrix, gemv_accumulates_into_output) {
+    TDynamicMatrix<int> a(2);
+    a[0][0] = 1; a[0][1] = 2;
+    a[1][0] = 3; a[1][1] = 4;
+    TDynamicVector<int> x(2), y(2);
+    x[0] = 1; x[1] = 1;
+    y[0] = 10; y[1] = 20;
+
+    gemv(2, a, x, -1, y);
+
+    EXPECT_EQ(y[0], -4);
+    EXPECT_EQ(y[1], -6);
+}
+
+TEST(TDynamicMatrix, gemv_throws_when_sizes_differ) {
+    TDynamicMatrix<int> a(2);
+    TDynamicVector<int> x(3), y(2);
+    ASSERT_ANY_THROW(gemv(1, a, x, 0, y));
+}
+
+TEST(TDynamicMatrix, batched_product_matches_single_products) {
+    const size_t n = 37, k = 11;
+    TDynamicMatrix<int> m(n);
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < n; j++)
+            m[i][j] = int(i * 7 + j * 3) % 13 - 6;
+    TDynamicVector<TDynamicVector<int>> xs(k);
+    for (size_t r = 0; r < k; r++) {
+        xs[r] = TDynamicVector<int>(n);
+        for (size_t j = 0; j < n; j++)
+            xs[r][j] = int(r + j) % 5 - 2;
+    }
+
+    TDynamicVector<TDynamicVector<int>> ys = m * xs;
+
+    ASSERT_EQ(ys.size(), k);
+    for (size_t r = 0; r < k; r++)
+        EXPECT_EQ(ys[r], m * xs[r]);
+}
+
+TEST(TDynamicMatrix, gemv_batch_accumulates_into_output) {
+    TDynamicMatrix<int> a(2);
+    a[0][0] = 1; a[0][1] = 2;
+    a[1][0] = 3; a[1][1] = 4;
+    TDynamicVector<TDynamicVector<int>> xs(2), ys(2);
+    xs[0] = TDynamicVector<int>(2); xs[0][0] = 1; xs[0][1] = 0;
+    xs[1] = TDynamicVector<int>(2); xs[1][0] = 0; xs[1][1] = 1;
+    ys[0] = TDynamicVector<int>(2); ys[0][0] = 1; ys[0][1] = 1;
+    ys[1] = TDynamicVector<int>(2); ys[1][0] = 2; ys[1][1] = 2;
+
+    gemv_batch(2, a, xs, 10, ys);
+
+    EXPECT_EQ(ys[0][0], 12);
+    EXPECT_EQ(ys[0][1], 16);
+    EXPECT_EQ(ys[1][0], 24);
+    EXPECT_EQ(ys[1][1], 28);
+}
+
+TEST(TDynamicMatrix, gemv_batch_throws_when_vector_sizes_differ) {
+    TDynamicMatrix<int> a(2);
+    TDynamicVector<TDynamicVector<int>> xs(2), ys(2);
+    xs[0] = TDynamicVector<int>(2); xs[1] = TDynamicVector<int>(3);
+    ys[0] = TDynamicVector<int>(2); ys[1] = TDynamicVector<int>(2);
+    ASSERT_ANY_THROW(gemv_batch(1, a, xs, 0, ys));
+}
+
+TEST(TDynamicMatrix, parallel_gemv_matches_serial_product) {
+    const size_t n = 50;
+    TDynamicMatrix<int> m(n);
+    TDynamicVector<int> x(n), y(n);
+    for (size_t i = 0; i < n; i++) {
+        x[i] = int(i % 7) - 3;
+        y[i] = 1;
+        for (size_t j = 0; j < n; j++)
+            m[i][j] = int(i * 5 + j) % 11 - 5;
+    }
+    TThreadPool pool(4);
+
+    gemv(pool, 1, m, x, 0, y);
+
+    EXPECT_EQ(y, m * x);
+}
+
+TEST(TDynamicMatrix, parallel_gemv_detaches_shared_output_once) {
+    const size_t n = 200;
+    TDynamicMatrix<int> m(n);
+    TDynamicVector<int> x(n), y(n);
+    for (size_t i = 0; i < n; i++) {
+        x[i] = int(i % 5) - 2;
+        y[i] = int(i);
+        for (size_t j = 0; j < n; j++)
+            m[i][j] = int(i + j * 3) % 7 - 3;
+    }
+    y.setCopyOnWrite(true);
+    TThreadPool pool(8);
+
+    for (int rep = 0; rep < 20; rep++) {
+        TDynamicVector<int> before(y);
+
+        gemv(pool, 1, m, x, 1, y);
+
+        EXPECT_FALSE(y.isShared());
+        EXPECT_EQ(before + m * x, y);
+    }
+}
+
+TEST(TDynamicMatrix, can_create_matrix_with_placement_policy) {
+    TThreadPool pool(3);
+    TDynamicMatrix<int> zero(7);
+
+    TDynamicMatrix<int> m1(7, TPlacement::firstTouch(), pool);
+    TDynamicMatrix<int> m2(7, TPlacement::interleaved(), pool);
+    TDynamicMatrix<int> m3(7, TPlacement::bind(pool.nodeOf(0)), pool);
+
+    EXPECT_EQ(zero, m1);
+    EXPECT_EQ(zero, m2);
+    EXPECT_EQ(zero, m3);
+}
+
+TEST(TDynamicMatrix, placed_matrix_takes_rows_from_non_thread_safe_arena) {
+    TThreadPool pool(4);
+    TArenaResource arena;
+    {
+        TMemoryScope scope(&arena);
+        TDynamicMatrix<double> m(400, TPlacement::firstTouch(), pool);
+
+        EXPECT_EQ(&arena, m.resource());
+        EXPECT_EQ(&arena, m[399].resource());
+        EXPECT_EQ(0.0, m[399][399]);
+    }
+}
+
+TEST(TDynamicMatrix, small_size_kernels_match_generic_loops) {
+    for (size_t n = 1; n <= TMATRIX_SMALL_KERNEL_MAX + 1; n++) {
+        TDynamicMatrix<int> a(n), b(n), c(n), expected(n);
+        TDynamicVector<int> x(n), y(n), expectedY(n);
+        for (size_t i = 0; i < n; i++) {
+            x[i] = int(i % 4) - 1;
+            y[i] = int(i);
+            for (size_t j = 0; j < n; j++) {
+                a[i][j] = int(i * 3 + j) % 7 - 3;
+                b[i][j] = int(i + j * 5) % 9 - 4;
+                c[i][j] = int(i + j);
+            }
+        }
+        for (size_t i = 0; i < n; i++) {
+            int sum = 0;
+            for (size_t k = 0; k < n; k++)
+                sum += a[i][k] * x[k];
+            expectedY[i] = 2 * sum + 3 * y[i];
+            for (size_t j = 0; j < n; j++) {
+                int prod = 0;
+                for (size_t k = 0; k < n; k++)
+                    prod += a[i][k] * b[k][j];
+                expected[i][j] = 2 * prod + 3 * c[i][j];
+            }
+        }
+
+        gemm(2, a, b, 3, c);
+        gemv(2, a, x, 3, y);
+
+        EXPECT_EQ(expected, c) << "n = " << n;
+        EXPECT_EQ(expectedY, y) << "n = " << n;
+    }
+}
+
+TEST(TDynamicMatrix, adopted_matrix_works_on_external_memory) {
+    int data[4] = { 1, 2, 3, 4 };
+    TDynamicMatrix<int> m(data, 2, adopt);
+    TDynamicVector<int> v(2);
+    v[0] = 5; v[1] = 6;
+
+    TDynamicVector<int> res = m * v;
+    m[1][0] = 30;
+
+    EXPECT_EQ(17, res[0]);
+    EXPECT_EQ(39, res[1]);
+    EXPECT_EQ(30, data[2]);
+}
+
+TEST(TDynamicMatrix, gemm_can_write_into_adopted_matrix) {
+    int a[4] = { 1, 2, 3, 4 }, b[4] = { 5, 6, 7, 8 }, c[4] = { 0, 0, 0, 0 };
+    TDynamicMatrix<int> ma(a, 2, adopt), mb(b, 2, adopt), mc(c, 2, adopt);
+
+    gemm(1, ma, mb, 0, mc);
+
+    EXPECT_EQ(19, c[0]);
+    EXPECT_EQ(22, c[1]);
+    EXPECT_EQ(43, c[2]);
+    EXPECT_EQ(50, c[3]);
+}
+
+TEST(TDynamicMatrix, assignment_of_same_size_writes_into_adopted_matrix) {
+    int data[4] = { 0, 0, 0, 0 };
+    TDynamicMatrix<int> m(data, 2, adopt), src(2);
+    src[0][1] = 5; src[1][0] = 6;
+
+    m = src;
+
+    EXPECT_EQ(5, data[1]);
+    EXPECT_EQ(6, data[2]);
+}
+
+TEST(TDynamicMatrix, assignment_of_expression_writes_into_adopted_matrix) {
+    int data[4] = { 0, 0, 0, 0 };
+    TDynamicMatrix<int> m(data, 2, adopt), a(2), b(2);
+    a[0][0] = 1; a[0][1] = 2; a[1][0] = 3; a[1][1] = 4;
+    b[0][0] = 10; b[1][1] = 20;
+
+    m = a + b;
+    m[1] = a[0] + a[0];
+
+    EXPECT_EQ(11, data[0]);
+    EXPECT_EQ(2, data[1]);
+    EXPECT_EQ(2, data[2]);
+    EXPECT_EQ(4, data[3]);
+    EXPECT_FALSE(m[0].owns());
+}
+
+TEST(TDynamicMatrix, cant_assign_matrix_of_other_size_to_adopted_matrix) {
+    int data[4] = { 1, 2, 3, 4 };
+    TDynamicMatrix<int> m(data, 2, adopt), big(3);
+
+    ASSERT_ANY_THROW(m = big);
+    ASSERT_ANY_THROW(m = big + big);
+    EXPECT_EQ(1, data[0]);
+    EXPECT_EQ(2, m.size());
+}
+
+static TDynamicMatrix<int> makeCountingMatrix(size_t n) {
+    TDynamicMatrix<int> m(n);
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < n; j++)
+            m[i][j] = int(i * n + j);
+    return m;
+}
+
+TEST(TDynamicMatrix, submatrix_view_shares_memory_with_matrix) {
+    TDynamicMatrix<int> m = makeCountingMatrix(4);
+
+    TMatrixView<int> v = m.submatrix(1, 2, 3, 2);
+    v(0, 1) = 100;
+    v[2][0] = 200;
+
+    EXPECT_EQ(3, v.rows());
+    EXPECT_EQ(2, v.cols());
+    EXPECT_EQ(6, v(0, 0));
+    EXPECT_EQ(100, m[1][3]);
+    EXPECT_EQ(200, m[3][2]);
+}
+
+TEST(TDynamicMatrix, throws_when_submatrix_exceeds_bounds) {
+    TDynamicMatrix<int> m(4);
+
+    ASSERT_ANY_THROW(m.submatrix(2, 2, 3, 1));
+    ASSERT_ANY_THROW(m.rowRange(3, 2));
+    ASSERT_ANY_THROW(m.column(4));
+}
+
+TEST(TDynamicMatrix, column_and_diagonal_views_follow_matrix) {
+    TDynamicMatrix<int> m = makeCountingMatrix(3);
+
+    TStridedView<int> col = m.column(1), diag = m.diagonal(), every2 = m.column(0, 2);
+    diag[2] = -1;
+
+    EXPECT_EQ(3, col.size());
+    EXPECT_EQ(7, col[2]);
+    EXPECT_EQ(4, diag[1]);
+    EXPECT_EQ(-1, m[2][2]);
+    EXPECT_EQ(2, every2.size());
+    EXPECT_EQ(6, every2[1]);
+}
+
+TEST(TDynamicMatrix, gemm_on_blocks_matches_product_of_copies) {
+    TDynamicMatrix<int> a = makeCountingMatrix(6), c(6);
+    TDynamicMatrix<int> blockA(3), blockB(3);
+    for (size_t i = 0; i < 3; i++)
+        for (size_t j = 0; j < 3; j++) {
+            blockA[i][j] = a[i][j + 3];
+            blockB[i][j] = a[i + 3][j];
+        }
+
+    gemm(1, a.submatrix(0, 3, 3, 3), a.submatrix(3, 0, 3, 3), 0, c.submatrix(3, 3, 3, 3));
+
+    TDynamicMatrix<int> expected = blockA * blockB;
+    for (size_t i = 0; i < 3; i++)
+        for (size_t j = 0; j < 3; j++)
+            EXPECT_EQ(expected[i][j], c[i + 3][j + 3]);
+    EXPECT_EQ(0, c[0][0]);
+}
+
+TEST(TDynamicMatrix, gemm_multiplies_rectangular_views) {
+    TDynamicMatrix<int> a = makeCountingMatrix(4), c(4);
+
+    gemm(1, a.submatrix(0, 0, 2, 3), a.submatrix(0, 0, 3, 1), 0, c.submatrix(0, 0, 2, 1));
+
+    EXPECT_EQ(0 * 0 + 1 * 4 + 2 * 8, c[0][0]);
+    EXPECT_EQ(4 * 0 + 5 * 4 + 6 * 8, c[1][0]);
+}
+
+TEST(TDynamicMatrix, gemm_throws_when_output_view_overlaps_input) {
+    TDynamicMatrix<int> a(4);
+
+    ASSERT_ANY_THROW(gemm(1, a.submatrix(0, 0, 2, 2), a.submatrix(2, 2, 2, 2), 0, a.submatrix(1, 1, 2, 2)));
+}
+
+TEST(TDynamicMatrix, gemv_accepts_row_range_and_strided_views) {
+    TDynamicMatrix<int> m = makeCountingMatrix(4), out(4);
+
+    gemv(1, m.rowRange(1, 2), m.column(0), 0, out.submatrix(0, 3, 2, 1).column(0));
+
+    EXPECT_EQ(4 * 0 + 5 * 4 + 6 * 8 + 7 * 12, out[0][3]);
+    EXPECT_EQ(8 * 0 + 9 * 4 + 10 * 8 + 11 * 12, out[1][3]);
+    ASSERT_ANY_THROW(gemv(1, m.rowRange(1, 2), m.column(0), 0, out.column(3)));
+}
+
+TEST(TDynamicMatrix, gemv_throws_when_output_overlaps_input_vector) {
+    TDynamicMatrix<int> m = makeCountingMatrix(4), a = makeCountingMatrix(3);
+    TDynamicVector<int> x(3);
+
+    // Column 0 and the diagonal share m[0][0]; below row 0 they are disjoint
+    ASSERT_ANY_THROW(gemv(1, a.view(), m.submatrix(0, 0, 3, 3).column(0), 0, m.submatrix(0, 0, 3, 3).diagonal()));
+    ASSERT_ANY_THROW(gemv(1, a.view(), x, 0, x));
+    // A row and a column cross at one element, whichever of them is the output
+    TDynamicMatrix<int> b = makeCountingMatrix(4);
+    ASSERT_ANY_THROW(gemv(1, b.rowRange(0, 4), b.column(1), 0, b[2]));
+    ASSERT_ANY_THROW(gemv(1, b.rowRange(0, 4), b[2], 0, b.column(1)));
+    ASSERT_NO_THROW(gemv(1, b.rowRange(0, 4), m[0], 0, b.column(1)));
+    ASSERT_NO_THROW(gemv(1, a.view(), m.submatrix(1, 0, 3, 1).column(0), 0, m.submatrix(1, 1, 3, 3).diagonal()));
+    EXPECT_EQ(0 * 4 + 1 * 8 + 2 * 12, m[1][1]);
+}
+
+TEST(TDynamicMatrix, add_works_on_views_in_place) {
+    TDynamicMatrix<int> m = makeCountingMatrix(4);
+
+    add(m.submatrix(0, 0, 2, 2), m.submatrix(2, 2, 2, 2), m.submatrix(0, 0, 2, 2));
+
+    EXPECT_EQ(0 + 10, m[0][0]);
+    EXPECT_EQ(5 + 15, m[1][1]);
+    EXPECT_EQ(10, m[2][2]);
+}
+
+TEST(TDynamicMatrix, copy_on_write_copy_detaches_only_written_row) {
+    TDynamicMatrix<int> m = makeCountingMatrix(3);
+    m.setCopyOnWrite(true);
+    TDynamicMatrix<int> copy(m);
+    const TDynamicMatrix<int>& cm = m;
+    const TDynamicMatrix<int>& ccopy = copy;
+
+    copy[1][1] = 100;
+
+    EXPECT_EQ(4, m[1][1]);
+    EXPECT_EQ(100, copy[1][1]);
+    EXPECT_NE(cm[1].data(), ccopy[1].data());
+    EXPECT_EQ(cm[0].data(), ccopy[0].data());
+    EXPECT_EQ(cm[2].data(), ccopy[2].data());
+}
+
+TEST(TDynamicMatrix, copy_on_write_matrix_operations_match_plain_ones) {
+    TDynamicMatrix<int> m = makeCountingMatrix(4), plain = makeCountingMatrix(4);
+    m.setCopyOnWrite(true);
+    TDynamicMatrix<int> copy(m);
+
+    EXPECT_EQ(plain * plain, copy * m);
+    copy.setCopyOnWrite(false);
+    copy[0][0] = -1;
+    EXPECT_EQ(0, m[0][0]);
+    EXPECT_FALSE(copy.copyOnWrite());
+}
+
+TEST(TDynamicMatrix, text_output_reads_back_unchanged) {
+    TDynamicMatrix<int> m = makeCountingMatrix(5), read(5);
+    std::stringstream ss;
+
+    ss << m;
+    ss >> read;
+
+    EXPECT_FALSE(ss.fail());
+    EXPECT_EQ(m, read);
+}
+
+TEST(TDynamicMatrix, read_into_copy_on_write_copy_keeps_original) {
+    TDynamicMatrix<int> m = makeCountingMatrix(2);
+    m.setCopyOnWrite(true);
+    TDynamicMatrix<int> copy(m);
+    std::istringstream in("9 9 9 9");
+
+    in >> copy;
+
+    EXPECT_EQ(9, copy[1][1]);
+    EXPECT_EQ(3, m[1][1]);
+}
+
+// Reference output: the per-element operator<< with std::endl per row
+template<typename T>
+static std::string referenceText(const TDynamicMatrix<T>& m, void (*setup)(std::ostream&))
+{
+    std::ostringstream ref;
+    setup(ref);
+    for (size_t i = 0; i < m.size(); i++) {
+        for (size_t j = 0; j < m.size(); j++)
+            ref << m[i][j] << " ";
+        ref << std::endl;
+    }
+    return ref.str();
+}
+
+template<typename T>
+static std::string bufferedText(const TDynamicMatrix<T>& m, void (*setup)(std::ostream&))
+{
+    std::ostringstream out;
+    setup(out);
+    out << m;
+    return out.str();
+}
+
+static TDynamicMatrix<double> makeFractionMatrix(size_t n)
+{
+    TDynamicMatrix<double> m(n);
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < n; j++)
+            m[i][j] = (double(i) - 3.0) / (j + 7.0) * (j % 3 == 0 ? 1e-7 : j % 3 == 1 ? 1.0 : 1e12);
+    return m;
+}
+
+TEST(TDynamicMatrix, buffered_output_matches_stream_format_for_doubles) {
+    TDynamicMatrix<double> m = makeFractionMatrix(9);
+    void (*setups[])(std::ostream&) = {
+        [](std::ostream&) {},
+        [](std::ostream& o) { o.precision(17); },
+        [](std::ostream& o) { o << std::fixed; o.precision(3); },
+        [](std::ostream& o) { o << std::scientific; },
+        [](std::ostream& o) { o << std::showpos << std::uppercase; },
+        [](std::ostream& o) { o.width(12); },
+    };
+
+    for (auto setup : setups)
+        EXPECT_EQ(referenceText(m, setup), bufferedText(m, setup));
+}
+
+TEST(TDynamicMatrix, buffered_output_of_small_matrix_handles_numbers_longer_than_buffer_slot) {
+    // 1e300 in fixed is over 300 characters: more than a small matrix buffer holds
+    TDynamicMatrix<double> m(2);
+    m[0][0] = 1e300;
+    m[0][1] = -2.5;
+    m[1][0] = 0.125;
+    m[1][1] = -1e300;
+    void (*setup)(std::ostream&) = [](std::ostream& o) { o << std::fixed; o.precision(2); };
+
+    EXPECT_EQ(referenceText(m, setup), bufferedText(m, setup));
+}
+
+TEST(TDynamicMatrix, buffered_output_matches_stream_format_for_large_int_matrix) {
+    TDynamicMatrix<int> m(300);
+    for (size_t i = 0; i < 300; i++)
+        for (size_t j = 0; j < 300; j++)
+            m[i][j] = int(i * 7919 - j * 104729);
+    void (*plain)(std::ostream&) = [](std::ostream&) {};
+    void (*hex)(std::ostream&) = [](std::ostream& o) { o << std::hex; };
+
+    EXPECT_EQ(referenceText(m, plain), bufferedText(m, plain));
+    EXPECT_EQ(referenceText(m, hex), bufferedText(m, hex));
+}
+
+// Stream buffer that counts flushes
+class TSyncCountingBuf : public std::stringbuf
+{
+public:
+    int syncs = 0;
+
+protected:
+    int sync() override
+    {
+        syncs++;
+        return std::stringbuf::sync();
+    }
+};
+
+TEST(TDynamicMatrix, output_flushes_stream_once) {
+    TSyncCountingBuf buf;
+    std::ostream out(&buf);
+
+    out << makeCountingMatrix(50);
+
+    EXPECT_EQ(1, buf.syncs);
+}
@@ -0,0 +1,217 @@
+#include "tmatrixio.h"
+
+#include <gtest.h>
+#include <cstdio>
+#include <sstream>
+
+static TDynamicMatrix<double> makeIoMatrix(size_t n)
+{
+  TDynamicMatrix<double> m(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      m[i][j] = i * 0.5 + j;
+  return m;
+}
+
+TEST(TMatrixIO, binary_stream_round_trip_preserves_matrix)
+{
+  TDynamicMatrix<double> m = makeIoMatrix(5);
+  std::stringstream ss(std::ios::in | std::ios::out | std::ios::binary);
+
+  writeBinary(ss, m);
+
+  EXPECT_EQ(sizeof(TBinaryHeader) + 25 * sizeof(double), ss.str().size());
+  EXPECT_EQ(m, readBinaryMatrix<double>(ss));
+}
+
+TEST(TMatrixIO, binary_file_round_trip_preserves_vector)
+{
+  TDynamicVector<int> v(4);
+  for (size_t i = 0; i < 4; i++)
+    v[i] = int(i) * 3 - 2;
+
+  saveBinary("test_tmatrixio_vector.bin", v);
+  TDynamicVector<int> loaded = loadBinaryVector<int>("test_tmatrixio_vector.bin");
+  std::remove("test_tmatrixio_vector.bin");
+
+  EXPECT_EQ(v, loaded);
+}
+
+TEST(TMatrixIO, throws_when_element_type_does_not_match)
+{
+  std::stringstream ss(std::ios::in | std::ios::out | std::ios::binary);
+  writeBinary(ss, makeIoMatrix(2));
+
+  ASSERT_ANY_THROW(readBinaryMatrix<float>(ss));
+}
+
+TEST(TMatrixIO, throws_when_data_is_truncated)
+{
+  std::stringstream out(std::ios::in | std::ios::out | std::ios::binary);
+  writeBinary(out, makeIoMatrix(3));
+  std::string bytes = out.str();
+  std::stringstream in(bytes.substr(0, bytes.size() - 1), std::ios::in | std::ios::binary);
+
+  ASSERT_ANY_THROW(readBinaryMatrix<double>(in));
+}
+
+TEST(TMatrixIO, throws_when_reading_text_as_binary)
+{
+  std::stringstream ss("1 2 3 4");
+
+  ASSERT_ANY_THROW(readBinaryVector<int>(ss));
+}
+
+TEST(TMatrixIO, mapped_matrix_works_on_file_pages_without_copy)
+{
+  TDynamicMatrix<double> m = makeIoMatrix(6);
+  saveBinary("test_tmatrixio_mapped.bin", m);
+  {
+    TMappedMatrix<double> mapped("test_tmatrixio_mapped.bin");
+    const TDynamicMatrix<double>& mm = mapped.matrix();
+
+    EXPECT_EQ(m, mm);
+    EXPECT_FALSE(mm[0].owns());
+    EXPECT_EQ(mm[0].data() + 6, mm[1].data());
+
+    mapped.matrix()[0][0] = 100;
+  }
+  TDynamicMatrix<double> reloaded = loadBinaryMatrix<double>("test_tmatrixio_mapped.bin");
+  std::remove("test_tmatrixio_mapped.bin");
+
+  EXPECT_EQ(m, reloaded);
+}
+
+TEST(TMatrixIO, writable_mapped_vector_changes_file)
+{
+  TDynamicVector<int> v(3);
+  saveBinary("test_tmatrixio_writable.bin", v);
+  {
+    TMappedVector<int> mapped("test_tmatrixio_writable.bin", true);
+    mapped.vector()[1] = 42;
+  }
+  TDynamicVector<int> reloaded = loadBinaryVector<int>("test_tmatrixio_writable.bin");
+  std::remove("test_tmatrixio_writable.bin");
+
+  EXPECT_EQ(42, reloaded[1]);
+}
+
+TEST(TMatrixIO, assigned_expression_is_written_to_writable_mapped_matrix)
+{
+  TDynamicMatrix<double> m = makeIoMatrix(5);
+  saveBinary("test_tmatrixio_assign.bin", TDynamicMatrix<double>(5));
+  {
+    TMappedMatrix<double> mapped("test_tmatrixio_assign.bin", true);
+    mapped.matrix() = m + m;
+
+    EXPECT_FALSE(mapped.matrix()[0].owns());
+  }
+  TDynamicMatrix<double> reloaded = loadBinaryMatrix<double>("test_tmatrixio_assign.bin");
+  std::remove("test_tmatrixio_assign.bin");
+
+  EXPECT_EQ(m + m, reloaded);
+}
+
+TEST(TMatrixIO, mapped_matrix_throws_on_missing_file)
+{
+  ASSERT_ANY_THROW(TMappedMatrix<double>("test_tmatrixio_missing.bin"));
+}
+
+static std::string textOf(const TDynamicMatrix<double>& m)
+{
+  std::ostringstream out;
+  out.precision(17);
+  out << m;
+  return out.str();
+}
+
+TEST(TMatrixIO, parallel_text_parse_matches_stream_input)
+{
+  TDynamicMatrix<double> m = makeIoMatrix(200);
+  std::string text = textOf(m);
+  TThreadPool pool(3, false);
+
+  TDynamicMatrix<double> parsed = parseTextMatrix<double>(text.data(), text.data() + text.size(), pool);
+
+  EXPECT_EQ(m, parsed);
+}
+
+TEST(TMatrixIO, text_parse_skips_blank_lines_and_carriage_returns)
+{
+  std::string text = "\n1 2\r\n \n3\t4\r\n";
+
+  TDynamicMatrix<int> m = parseTextMatrix<int>(text.data(), text.data() + text.size());
+
+  ASSERT_EQ(2, m.size());
+  EXPECT_EQ(2, m[0][1]);
+  EXPECT_EQ(3, m[1][0]);
+}
+
+TEST(TMatrixIO, text_parse_reports_line_and_column_of_invalid_number)
+{
+  std::string text = "1 2\n3 x4\n";
+
+  try {
+    parseTextMatrix<int>(text.data(), text.data() + text.size());
+    FAIL();
+  } catch (const TTextParseError& e) {
+    EXPECT_EQ(2, e.line());
+    EXPECT_EQ(3, e.column());
+  }
+}
+
+TEST(TMatrixIO, text_parse_reports_short_row)
+{
+  std::string text = "1 2\n3\n";
+
+  try {
+    parseTextMatrix<int>(text.data(), text.data() + text.size());
+    FAIL();
+  } catch (const TTextParseError& e) {
+    EXPECT_EQ(2, e.line());
+    EXPECT_EQ(2, e.column());
+  }
+}
+
+TEST(TMatrixIO, text_parse_reports_first_error_across_chunks)
+{
+  std::string text = textOf(makeIoMatrix(200));
+  size_t line = 1, pos = 0;
+  while (line < 150) {
+    pos = text.find('\n', pos) + 1;
+    line++;
+  }
+  size_t second = text.find(' ', pos) + 1;
+  text[second] = '?';
+  text[text.size() - 3] = '?';
+  TThreadPool pool(3, false);
+
+  try {
+    parseTextMatrix<double>(text.data(), text.data() + text.size(), pool);
+    FAIL();
+  } catch (const TTextParseError& e) {
+    EXPECT_EQ(150, e.line());
+    EXPECT_EQ(second - pos + 1, e.column());
+  }
+}
+
+TEST(TMatrixIO, can_load_text_matrix_file)
+{
+  TDynamicMatrix<double> m = makeIoMatrix(7);
+  {
+    std::ofstream f("test_tmatrixio_text.txt");
+    f << m;
+  }
+
+  TDynamicMatrix<double> loaded = loadTextMatrix<double>("test_tmatrixio_text.txt");
+  std::remove("test_tmatrixio_text.txt");
+
+  EXPECT_EQ(m, loaded);
+}
+
+TEST(TMatrixIO, empty_text_is_an_error)
+{
+  std::string text = " \n\n";
+
+  ASSERT_THROW(parseTextMatrix<int>(text.data(), text.data() + text.size()), TTextParseError);
+}
@@ -0,0 +1,206 @@
+#include "tmatrix.h"
+
+#include <gtest.h>
+#include <thread>
+
+// Источник памяти, считающий выделения
+class TCountingResource : public std::pmr::memory_resource
+{
+public:
+  size_t allocations = 0, deallocations = 0;
+
+protected:
+  void* do_allocate(size_t bytes, size_t align) override
+  {
+    allocations++;
+    return std::pmr::new_delete_resource()->allocate(bytes, align);
+  }
+
+  void do_deallocate(void* p, size_t bytes, size_t align) override
+  {
+    deallocations++;
+    std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+  {
+    return this == &other;
+  }
+};
+
+TEST(TArenaResource, vector_can_take_memory_from_arena)
+{
+  TArenaResource arena;
+  TDynamicVector<int> v(100, &arena);
+
+  EXPECT_EQ(&arena, v.resource());
+  EXPECT_GE(arena.bytesUsed(), 100 * sizeof(int));
+}
+
+TEST(TArenaResource, operation_results_come_from_operand_resource)
+{
+  TArenaResource arena;
+  TDynamicVector<int> v(10, &arena);
+  size_t before = arena.bytesUsed();
+
+  TDynamicVector<int> res = v + 1;
+
+  EXPECT_EQ(&arena, res.resource());
+  EXPECT_GT(arena.bytesUsed(), before);
+}
+
+TEST(TArenaResource, reset_reuses_memory_without_new_blocks)
+{
+  TArenaResource arena(256);
+  for (int round = 0; round < 3; round++) {
+    {
+      TMemoryScope scope(&arena);
+      TDynamicMatrix<double> a(8), b(8);
+      TDynamicMatrix<double> c = a * b + a;
+    }
+    if (round == 0)
+      arena.reset();
+    else {
+      EXPECT_EQ(1, arena.blockCount());
+      arena.reset();
+    }
+  }
+  EXPECT_EQ(0, arena.bytesUsed());
+}
+
+TEST(TMemoryScope, sets_and_restores_current_resource)
+{
+  TArenaResource arena;
+  std::pmr::memory_resource* before = currentMemoryResource();
+  {
+    TMemoryScope scope(&arena);
+    TDynamicMatrix<int> m(3);
+    EXPECT_EQ(&arena, m.resource());
+    EXPECT_EQ(&arena, m[0].resource());
+  }
+  EXPECT_EQ(before, currentMemoryResource());
+}
+
+TEST(TMemoryScope, copy_leaves_scope_resource)
+{
+  TArenaResource arena;
+  TDynamicVector<int> v(5, &arena);
+  v[2] = 7;
+
+  TDynamicVector<int> copy(v);
+
+  EXPECT_EQ(currentMemoryResource(), copy.resource());
+  EXPECT_EQ(v, copy);
+}
+
+TEST(TPoolResource, reuses_freed_blocks_of_same_class)
+{
+  TCountingResource upstream;
+  TPoolResource pool(1024 * 1024, 64 * 1024, &upstream);
+  for (int i = 0; i < 100; i++) {
+    TDynamicVector<double> v(1000, &pool);
+    v[0] = i;
+  }
+
+  EXPECT_EQ(1, upstream.allocations);
+  EXPECT_EQ(1, pool.chunkCount());
+}
+
+TEST(TPoolResource, passes_large_requests_to_upstream)
+{
+  TCountingResource upstream;
+  TPoolResource pool(1024, 64 * 1024, &upstream);
+  {
+    TDynamicVector<char> v(4096, &pool);
+  }
+
+  EXPECT_EQ(1, upstream.allocations);
+  EXPECT_EQ(1, upstream.deallocations);
+}
+
+TEST(TPoolResource, matrix_copy_can_target_pool)
+{
+  TPoolResource pool;
+  TDynamicMatrix<int> m(4);
+  m[1][2] = 5;
+
+  TDynamicMatrix<int> copy(m, &pool);
+
+  EXPECT_EQ(m, copy);
+  EXPECT_EQ(&pool, copy.resource());
+  EXPECT_EQ(&pool, copy[3].resource());
+}
+
+TEST(TBufferCache, is_default_resource)
+{
+  TDynamicVector<int> v(10);
+
+  EXPECT_EQ(&TBufferCache::instance(), v.resource());
+}
+
+TEST(TBufferCache, repeated_temporaries_of_same_size_hit_cache)
+{
+  TBufferCacheStats st;
+  std::thread t([&] {
+    TDynamicVector<double> a(1000), b(1000);
+    TBufferCache::resetStats();
+    for (int i = 0; i < 10; i++) {
+      TDynamicVector<double> c = a + b;
+    }
+    st = TBufferCache::stats();
+  });
+  t.join();
+
+  EXPECT_EQ(1, st.misses);
+  EXPECT_EQ(9, st.hits);
+  EXPECT_EQ(1, st.cachedBuffers);
+}
+
+TEST(TBufferCache, placed_matrix_rows_do_not_reuse_cached_buffers)
+{
+  TBufferCacheStats st;
+  std::pmr::memory_resource* rowRes = nullptr;
+  std::thread t([&] {
+    TThreadPool pool(2);
+    {
+      std::vector<TDynamicVector<double>> warm; // 50 буферов размера строки попадают в кэш
+      for (int i = 0; i < 50; i++)
+        warm.emplace_back(50);
+    }
+    TBufferCache::resetStats();
+    TDynamicMatrix<double> m(50, TPlacement::firstTouch(), pool);
+    st = TBufferCache::stats();
+    rowRes = m[0].resource();
+  });
+  t.join();
+
+  EXPECT_EQ(0, st.hits);
+  EXPECT_LE(50, st.cachedBuffers);
+  EXPECT_EQ(std::pmr::new_delete_resource(), rowRes);
+}
+
+TEST(TBufferCache, buffers_larger_than_capacity_bypass_cache)
+{
+  TBufferCacheStats st;
+  std::thread t([&] {
+    TBufferCache::setCapacity(1024);
+    {
+      TDynamicVector<char> big(4096);
+    }
+    st = TBufferCache::stats();
+  });
+  t.join();
+
+  EXPECT_EQ(1, st.bypasses);
+  EXPECT_EQ(0, st.cachedBuffers);
+}
+
+TEST(TBufferCache, clear_empties_cache)
+{
+  {
+    TDynamicVector<int> v(100);
+  }
+  TBufferCache::clear();
+
+  EXPECT_EQ(0, TBufferCache::stats().cachedBytes);
+}
@@ -0,0 +1,114 @@
+#include "tparallel.h"
+
+#include <gtest.h>
+#include <atomic>
+
+TEST(TThreadPool, can_create_pool_with_given_size)
+{
+  TThreadPool pool(3);
+
+  EXPECT_EQ(3, pool.size());
+}
+
+TEST(TThreadPool, run_calls_every_worker_once)
+{
+  TThreadPool pool(4);
+  std::atomic<int> mask(0);
+
+  pool.run([&](size_t w) { mask |= 1 << w; });
+
+  EXPECT_EQ(15, mask.load());
+}
+
+TEST(TThreadPool, parallel_for_covers_range_exactly_once)
+{
+  TThreadPool pool(3);
+  std::vector<int> hits(100, 0);
+
+  pool.parallelFor(0, hits.size(), [&](size_t lo, size_t hi, size_t) {
+    for (size_t i = lo; i < hi; i++)
+      hits[i]++;
+  });
+
+  EXPECT_EQ(std::vector<int>(100, 1), hits);
+}
+
+TEST(TThreadPool, parallel_for_gives_worker_the_same_part_every_time)
+{
+  TThreadPool pool(4);
+  std::vector<size_t> first(10), second(10);
+
+  pool.parallelFor(0, 10, [&](size_t lo, size_t hi, size_t w) {
+    for (size_t i = lo; i < hi; i++) first[i] = w;
+  });
+  pool.parallelFor(0, 10, [&](size_t lo, size_t hi, size_t w) {
+    for (size_t i = lo; i < hi; i++) second[i] = w;
+  });
+
+  EXPECT_EQ(first, second);
+}
+
+TEST(TThreadPool, run_rethrows_worker_exception)
+{
+  TThreadPool pool(2);
+
+  ASSERT_ANY_THROW(pool.run([](size_t w) { if (w == 1) throw std::runtime_error("fail"); }));
+  ASSERT_NO_THROW(pool.run([](size_t) {}));
+}
+
+TEST(TNumaTopology, has_at_least_one_node_with_cpus)
+{
+  const TNumaTopology& topo = TNumaTopology::get();
+
+  ASSERT_GE(topo.nodeCount(), 1);
+  EXPECT_FALSE(topo.cpus(0).empty());
+}
+
+static std::vector<size_t> placedWorkers(TThreadPool& pool, size_t n, const TPlacement& placement)
+{
+  std::vector<size_t> owner(n, size_t(-1));
+  std::vector<std::thread::id> ids(pool.size());
+  pool.run([&](size_t w) { ids[w] = std::this_thread::get_id(); });
+  pool.forEachPlaced(n, placement, [&](size_t i) {
+    owner[i] = std::find(ids.begin(), ids.end(), std::this_thread::get_id()) - ids.begin();
+  });
+  return owner;
+}
+
+TEST(TThreadPool, first_touch_placement_matches_parallel_for_partition)
+{
+  TThreadPool pool(3);
+  std::vector<size_t> owner = placedWorkers(pool, 20, TPlacement::firstTouch());
+
+  for (size_t w = 0; w < pool.size(); w++)
+    for (size_t i = pool.partBegin(0, 20, w); i < pool.partBegin(0, 20, w + 1); i++)
+      EXPECT_EQ(w, owner[i]);
+}
+
+TEST(TThreadPool, interleaved_placement_visits_every_index_once)
+{
+  TThreadPool pool(3);
+  std::vector<int> hits(31, 0);
+
+  pool.forEachPlaced(hits.size(), TPlacement::interleaved(), [&](size_t i) { hits[i]++; });
+
+  EXPECT_EQ(std::vector<int>(31, 1), hits);
+}
+
+TEST(TThreadPool, bind_placement_uses_only_workers_of_node)
+{
+  TThreadPool pool(2);
+  std::vector<size_t> owner = placedWorkers(pool, 10, TPlacement::bind(pool.nodeOf(0)));
+
+  for (size_t i = 0; i < owner.size(); i++) {
+    ASSERT_LT(owner[i], pool.size());
+    EXPECT_EQ(pool.nodeOf(0), pool.nodeOf(owner[i]));
+  }
+}
+
+TEST(TThreadPool, throws_when_bind_to_node_without_workers)
+{
+  TThreadPool pool(1);
+
+  ASSERT_ANY_THROW(pool.forEachPlaced(5, TPlacement::bind(TNumaTopology::get().nodeCount()), [](size_t) {}));
+}
@@ -0,0 +1,123 @@
+#include "tpipeline.h"
+
+#include <gtest.h>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include "tmatrix.h"
+
+static TDynamicMatrix<double> makePipelineMatrix(size_t n, double shift)
+{
+  TDynamicMatrix<double> m(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      m[i][j] = shift + i * 0.5 - j;
+  return m;
+}
+
+TEST(TBoundedQueue, pop_drains_items_after_close)
+{
+  TBoundedQueue<int> q(2);
+  int v;
+
+  ASSERT_TRUE(q.push(1));
+  ASSERT_TRUE(q.push(2));
+  q.close();
+
+  EXPECT_FALSE(q.push(3));
+  ASSERT_TRUE(q.pop(v));
+  EXPECT_EQ(1, v);
+  ASSERT_TRUE(q.pop(v));
+  EXPECT_EQ(2, v);
+  EXPECT_FALSE(q.pop(v));
+}
+
+TEST(TPipeline, parse_multiply_format_matches_sequential_result)
+{
+  const size_t n = 6, count = 20;
+  TDynamicMatrix<double> fixed = makePipelineMatrix(n, 1.0);
+  std::stringstream in, expected, out;
+  for (size_t k = 0; k < count; k++)
+    in << makePipelineMatrix(n, double(k));
+  for (size_t k = 0; k < count; k++) {
+    TDynamicMatrix<double> r(n);
+    gemm(1.0, makePipelineMatrix(n, double(k)), fixed, 0.0, r);
+    expected << r;
+  }
+  TPipeline p(2);
+
+  p.source([&]() -> std::optional<TDynamicMatrix<double>> {
+      TDynamicMatrix<double> m(n);
+      if (!(in >> m))
+        return std::nullopt;
+      return m;
+    })
+   .map([&](TDynamicMatrix<double> m) {
+      TDynamicMatrix<double> r(n);
+      gemm(1.0, m, fixed, 0.0, r);
+      return r;
+    }, 3)
+   .map([](TDynamicMatrix<double> r) {
+      std::ostringstream s;
+      s << r;
+      return s.str();
+    }, 2)
+   .sink([&](std::string text) { out << text; });
+  p.run();
+
+  EXPECT_EQ(expected.str(), out.str());
+}
+
+TEST(TPipeline, bounded_queues_limit_items_in_flight)
+{
+  const size_t capacity = 2, threads = 2;
+  std::atomic<size_t> produced(0), consumed(0), maxAhead(0);
+  TPipeline p(capacity);
+
+  p.source([&]() -> std::optional<int> {
+      size_t k = produced++;
+      if (k == 200)
+        return std::nullopt;
+      size_t ahead = k - consumed.load();
+      if (ahead > maxAhead)
+        maxAhead = ahead;
+      return int(k);
+    })
+   .map([](int v) { return v * 2; }, threads)
+   .sink([&](int v) {
+      EXPECT_EQ(int(consumed.load()) * 2, v);
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      consumed++;
+    });
+  p.run();
+
+  EXPECT_EQ(200, consumed.load());
+  // Two queues, the stage threads, the source and the sink
+  EXPECT_LE(maxAhead.load(), 2 * capacity + threads + 2);
+}
+
+TEST(TPipeline, stage_exception_stops_pipeline_and_is_rethrown)
+{
+  std::atomic<int> sunk(0);
+  TPipeline p(1);
+
+  p.source([n = 0]() mutable -> std::optional<int> { return n++; })
+   .map([](int v) {
+      if (v == 10)
+        throw std::runtime_error("bad item");
+      return v;
+    }, 2)
+   .sink([&](int) { sunk++; });
+
+  ASSERT_THROW(p.run(), std::runtime_error);
+  EXPECT_LE(sunk.load(), 10);
+}
+
+TEST(TPipeline, run_requires_source_and_sink)
+{
+  TPipeline p;
+
+  p.source([]() -> std::optional<int> { return std::nullopt; });
+
+  ASSERT_THROW(p.run(), std::logic_error);
+}
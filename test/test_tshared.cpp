@@ -0,0 +1,120 @@
+#include "tshared.h"
+
+#include <gtest.h>
+#include <string>
+
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#endif
+
+static std::string sharedName(const char* tag)
+{
+#if defined(_WIN32)
+  return std::string("test_tshared_") + tag;
+#else
+  return std::string("test_tshared_") + tag + "_" + std::to_string(getpid());
+#endif
+}
+
+static TDynamicMatrix<double> makeSharedMatrix(size_t n)
+{
+  TDynamicMatrix<double> m(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      m[i][j] = i * 1.5 - j;
+  return m;
+}
+
+TEST(TSharedMatrix, attached_matrix_uses_creator_memory)
+{
+  std::string name = sharedName("attach");
+  TDynamicMatrix<double> m = makeSharedMatrix(20);
+  TSharedMatrix<double> created(name, m);
+
+  TSharedMatrix<double> attached(name, TSharedMemory::ReadWrite);
+
+  EXPECT_EQ(m, attached.matrix());
+  EXPECT_FALSE(attached.matrix()[0].owns());
+  attached.matrix()[3][4] = 100.0;
+  EXPECT_EQ(100.0, created.matrix()[3][4]);
+}
+
+TEST(TSharedMatrix, assigned_expression_is_seen_by_other_attachment)
+{
+  std::string name = sharedName("assign");
+  TDynamicMatrix<double> a = makeSharedMatrix(6), b = makeSharedMatrix(6);
+  TSharedMatrix<double> created(name, TDynamicMatrix<double>(6));
+  TSharedMatrix<double> writer(name, TSharedMemory::ReadWrite);
+
+  writer.matrix() = a * b;
+  TSharedMatrix<double> reader(name);
+
+  EXPECT_FALSE(writer.matrix()[0].owns());
+  EXPECT_EQ(a * b, reader.matrix());
+  EXPECT_EQ(a * b, created.matrix());
+  ASSERT_ANY_THROW(writer.matrix() = makeSharedMatrix(7));
+}
+
+TEST(TSharedMatrix, read_only_attach_keeps_writes_private)
+{
+  std::string name = sharedName("private");
+  TSharedMatrix<int> created(name, TDynamicMatrix<int>(4));
+
+  TSharedMatrix<int> reader(name);
+  reader.matrix()[1][1] = 7;
+
+  EXPECT_EQ(7, reader.matrix()[1][1]);
+  EXPECT_EQ(0, created.matrix()[1][1]);
+}
+
+TEST(TSharedMatrix, attach_requires_published_segment_of_same_type)
+{
+  std::string name = sharedName("publish");
+  TSharedMatrix<double> created(name, 8);
+
+  ASSERT_THROW(TSharedMatrix<double>(name, TSharedMemory::Read), std::runtime_error);
+  created.publish();
+  ASSERT_NO_THROW(TSharedMatrix<double>(name, TSharedMemory::Read));
+  ASSERT_THROW(TSharedMatrix<float>(name, TSharedMemory::Read), std::runtime_error);
+}
+
+TEST(TSharedMatrix, create_fails_for_existing_name_and_segment_is_removed_with_creator)
+{
+  std::string name = sharedName("owner");
+  {
+    TSharedMatrix<int> created(name, TDynamicMatrix<int>(3));
+
+    ASSERT_ANY_THROW(TSharedMatrix<int>(name, 3));
+  }
+  ASSERT_ANY_THROW(TSharedMatrix<int>(name, TSharedMemory::Read));
+}
+
+#if !defined(_WIN32)
+TEST(TSharedMatrix, other_process_sees_the_same_matrix)
+{
+  std::string name = sharedName("fork");
+  TDynamicMatrix<double> m = makeSharedMatrix(50);
+  TSharedMatrix<double> created(name, m);
+
+  pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+  if (pid == 0) {
+    int code = 1;
+    try {
+      TSharedMatrix<double> attached(name, TSharedMemory::ReadWrite);
+      if (attached.matrix() == m) {
+        attached.matrix()[49][49] = -1.0;
+        code = 0;
+      }
+    } catch (...) {
+    }
+    _exit(code);
+  }
+  int status = 0;
+  waitpid(pid, &status, 0);
+
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+  EXPECT_EQ(-1.0, created.matrix()[49][49]);
+}
+#endif
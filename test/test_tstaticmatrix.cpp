@@ -0,0 +1,103 @@
+#include "tstaticmatrix.h"
+
+#include <gtest.h>
+
+constexpr TStaticMatrix<int, 2> makeStaticMatrix(int a, int b, int c, int d)
+{
+  TStaticMatrix<int, 2> m;
+  m[0][0] = a; m[0][1] = b;
+  m[1][0] = c; m[1][1] = d;
+  return m;
+}
+
+TEST(TStaticVector, operations_are_constexpr)
+{
+  constexpr TStaticVector<int, 3> v = TStaticVector<int, 3>() + 2;
+  static_assert(v[0] == 2 && v[2] == 2, "constexpr scalar addition");
+  static_assert(v * v == 12, "constexpr scalar product");
+  static_assert(sizeof(TStaticVector<double, 4>) == 4 * sizeof(double), "no heap storage");
+
+  EXPECT_EQ(3, v.size());
+}
+
+TEST(TStaticVector, can_add_and_subtract_vectors)
+{
+  TStaticVector<int, 3> v1, v2;
+  v1[0] = 1; v1[1] = 2; v1[2] = 3;
+  v2[0] = 4; v2[1] = 5; v2[2] = 6;
+
+  TStaticVector<int, 3> sum = v1 + v2, diff = v2 - v1;
+
+  EXPECT_EQ(5, sum[0]); EXPECT_EQ(7, sum[1]); EXPECT_EQ(9, sum[2]);
+  EXPECT_EQ(3, diff[0]); EXPECT_EQ(3, diff[1]); EXPECT_EQ(3, diff[2]);
+  EXPECT_EQ(32, v1 * v2);
+}
+
+TEST(TStaticVector, throws_when_index_is_too_large)
+{
+  TStaticVector<int, 3> v;
+
+  ASSERT_ANY_THROW(v.at(3));
+}
+
+TEST(TStaticVector, converts_to_and_from_dynamic_vector)
+{
+  TDynamicVector<int> d(3);
+  d[0] = 7; d[1] = 8; d[2] = 9;
+
+  TStaticVector<int, 3> s(d);
+  TDynamicVector<int> back = s;
+
+  EXPECT_EQ(8, s[1]);
+  EXPECT_EQ(d, back);
+}
+
+TEST(TStaticVector, throws_when_converting_dynamic_vector_of_other_size)
+{
+  TDynamicVector<int> d(4);
+
+  ASSERT_ANY_THROW((TStaticVector<int, 3>(d)));
+}
+
+TEST(TStaticMatrix, product_is_constexpr)
+{
+  constexpr TStaticMatrix<int, 2> p = makeStaticMatrix(1, 2, 3, 4) * makeStaticMatrix(5, 6, 7, 8);
+  static_assert(p[0][0] == 19 && p[0][1] == 22 && p[1][0] == 43 && p[1][1] == 50, "constexpr product");
+
+  EXPECT_EQ(makeStaticMatrix(19, 22, 43, 50), p);
+}
+
+TEST(TStaticMatrix, can_add_subtract_and_scale_matrices)
+{
+  TStaticMatrix<int, 2> a = makeStaticMatrix(1, 2, 3, 4), b = makeStaticMatrix(10, 20, 30, 40);
+
+  EXPECT_EQ(makeStaticMatrix(11, 22, 33, 44), a + b);
+  EXPECT_EQ(makeStaticMatrix(9, 18, 27, 36), b - a);
+  EXPECT_EQ(makeStaticMatrix(2, 4, 6, 8), a * 2);
+}
+
+TEST(TStaticMatrix, can_multiply_matrix_by_vector)
+{
+  TStaticVector<int, 2> v;
+  v[0] = 5; v[1] = 6;
+
+  TStaticVector<int, 2> res = makeStaticMatrix(1, 2, 3, 4) * v;
+
+  EXPECT_EQ(17, res[0]);
+  EXPECT_EQ(39, res[1]);
+}
+
+TEST(TStaticMatrix, matches_dynamic_matrix_product)
+{
+  TDynamicMatrix<double> a(4), b(4);
+  for (size_t i = 0; i < 4; i++)
+    for (size_t j = 0; j < 4; j++) {
+      a[i][j] = double(i + 2 * j);
+      b[i][j] = double(3 * i) - double(j);
+    }
+
+  TDynamicMatrix<double> expected = a * b;
+  TDynamicMatrix<double> res = TStaticMatrix<double, 4>(a) * TStaticMatrix<double, 4>(b);
+
+  EXPECT_EQ(expected, res);
+}
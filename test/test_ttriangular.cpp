@@ -0,0 +1,128 @@
+#include "ttriangular.h"
+
+#include <gtest.h>
+#include <cmath>
+
+static TDynamicMatrix<double> makeTriangularSource(size_t n)
+{
+  TDynamicMatrix<double> m(n);
+  unsigned state = 777;
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++) {
+      state = state * 1103515245u + 12345u;
+      m[i][j] = double(state >> 8) / double(1u << 24) - 0.5;
+    }
+  for (size_t i = 0; i < n; i++)
+    m[i][i] += 2.0; // Well conditioned triangles
+  return m;
+}
+
+static TDynamicVector<double> column(const TDynamicMatrix<double>& m, size_t c)
+{
+  TDynamicVector<double> v(m.size());
+  for (size_t i = 0; i < m.size(); i++)
+    v[i] = m[i][c];
+  return v;
+}
+
+TEST(TTriangularMatrix, packed_rows_hold_only_the_triangle)
+{
+  TDynamicMatrix<double> m = makeTriangularSource(5);
+
+  TTriangularMatrix<double> u = TTriangularMatrix<double>::fromMatrix(m, TTriangle::Upper);
+  TTriangularMatrix<double> l = TTriangularMatrix<double>::fromMatrix(m, TTriangle::Lower);
+
+  EXPECT_EQ(15, u.packed().size());
+  EXPECT_EQ(m[1][3], u.at(1, 3));
+  EXPECT_EQ(m[3][1], l.at(3, 1));
+  EXPECT_EQ(0.0, u.get(3, 1));
+  EXPECT_EQ(0.0, u.toMatrix()[4][0]);
+  EXPECT_EQ(m[0][4], u.toMatrix()[0][4]);
+  ASSERT_ANY_THROW(u.at(3, 1));
+  ASSERT_ANY_THROW(l.at(1, 3));
+}
+
+TEST(TTriangular, trsv_solves_upper_and_lower_in_both_storages)
+{
+  const size_t n = 90;
+  TDynamicMatrix<double> m = makeTriangularSource(n);
+  TDynamicVector<double> x(n);
+  for (size_t i = 0; i < n; i++)
+    x[i] = double(i % 9) - 4;
+
+  for (TTriangle t : { TTriangle::Upper, TTriangle::Lower }) {
+    TTriangularMatrix<double> packed = TTriangularMatrix<double>::fromMatrix(m, t);
+    TDynamicVector<double> b = packed.toMatrix() * x, dense = b, compact = b;
+
+    trsv(t, m, dense);
+    trsv(packed, compact);
+
+    for (size_t i = 0; i < n; i++) {
+      EXPECT_NEAR(x[i], dense[i], 1e-10);
+      EXPECT_EQ(dense[i], compact[i]);
+    }
+  }
+}
+
+TEST(TTriangular, unit_diagonal_is_not_read)
+{
+  TDynamicMatrix<double> m(3);
+  m[1][0] = 2; m[2][0] = 1; m[2][1] = 3;
+  TDynamicVector<double> b(3);
+  b[0] = 1; b[1] = 4; b[2] = 10;
+
+  trsv(TTriangle::Lower, m, b, TDiagonal::Unit);
+
+  EXPECT_EQ(1.0, b[0]);
+  EXPECT_EQ(2.0, b[1]);
+  EXPECT_EQ(3.0, b[2]);
+  ASSERT_THROW(trsv(TTriangle::Lower, m, b), std::runtime_error);
+}
+
+TEST(TTriangular, blocked_trsm_matches_trsv_per_column)
+{
+  const size_t n = 150;
+  TDynamicMatrix<double> m = makeTriangularSource(n), b(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      b[i][j] = std::cos(double(i + 3 * j));
+
+  for (TTriangle t : { TTriangle::Upper, TTriangle::Lower }) {
+    TDynamicMatrix<double> x = b;
+    trsm(t, 2.0, m, x);
+
+    for (size_t c = 0; c < n; c += 29) {
+      TDynamicVector<double> xc = column(b, c) * 2.0;
+      trsv(t, m, xc);
+      for (size_t i = 0; i < n; i++)
+        EXPECT_NEAR(xc[i], x[i][c], 1e-10);
+    }
+  }
+}
+
+TEST(TTriangular, packed_trsm_matches_dense_trsm_on_view)
+{
+  const size_t n = 130;
+  TDynamicMatrix<double> m = makeTriangularSource(n), b(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      b[i][j] = double(i) - double(j) / 7;
+  TTriangularMatrix<double> u = TTriangularMatrix<double>::fromMatrix(m);
+  TDynamicMatrix<double> dense = b, compact = b;
+
+  trsm(TTriangle::Upper, 1.0, m, dense.submatrix(0, 10, n, 37), TDiagonal::Unit);
+  trsm(1.0, u, compact.submatrix(0, 10, n, 37), TDiagonal::Unit);
+
+  EXPECT_EQ(dense, compact);
+  EXPECT_EQ(b[5][9], dense[5][9]);
+  EXPECT_EQ(b[5][47], dense[5][47]);
+  EXPECT_NE(b[5][10], dense[5][10]);
+}
+
+TEST(TTriangular, trsm_rejects_wrong_shape)
+{
+  TDynamicMatrix<double> m = makeTriangularSource(8), b(8);
+
+  ASSERT_THROW(trsm(TTriangle::Lower, 1.0, m, b.submatrix(0, 0, 7, 8)), std::invalid_argument);
+  ASSERT_THROW(trsm(TTriangle::Lower, 1.0, m, m), std::invalid_argument);
+}
@@ -1,6 +1,7 @@
 #include "tmatrix.h"
 
 #include <gtest.h>
+#include <sstream>
 
 TEST(TDynamicVector, can_create_vector_with_positive_length)
 {
@@ -345,3 +346,190 @@ TEST(TDynamicVector, can_multiply_vectors_with_equal_size) {
     int result = v1 * v2;
     EXPECT_EQ(result, 32); // 1*4 + 2*5 + 3*6 = 32
 }
+
+TEST(TDynamicVector, adopted_vector_works_on_external_memory) {
+    int arr[3] = { 1, 2, 3 };
+    TDynamicVector<int> v(arr, 3, adopt);
+
+    v[1] = 20;
+
+    EXPECT_FALSE(v.owns());
+    EXPECT_EQ(arr, v.data());
+    EXPECT_EQ(20, arr[1]);
+}
+
+TEST(TDynamicVector, operations_on_adopted_vectors_give_owning_results) {
+    int a[3] = { 1, 2, 3 }, b[3] = { 4, 5, 6 };
+    TDynamicVector<int> va(a, 3, adopt), vb(b, 3, adopt);
+
+    TDynamicVector<int> sum = va + vb;
+
+    EXPECT_TRUE(sum.owns());
+    EXPECT_EQ(5, sum[0]);
+    EXPECT_EQ(9, sum[2]);
+    EXPECT_EQ(32, va * vb);
+}
+
+TEST(TDynamicVector, assignment_of_same_size_writes_into_adopted_memory) {
+    int arr[2] = { 0, 0 };
+    TDynamicVector<int> v(arr, 2, adopt), src(2);
+    src[0] = 7; src[1] = 8;
+
+    v = src;
+
+    EXPECT_FALSE(v.owns());
+    EXPECT_EQ(7, arr[0]);
+    EXPECT_EQ(8, arr[1]);
+}
+
+TEST(TDynamicVector, assignment_of_expression_writes_into_adopted_memory) {
+    int arr[2] = { 0, 0 };
+    TDynamicVector<int> v(arr, 2, adopt), a(2);
+    a[0] = 3; a[1] = 4;
+
+    v = a + a;
+
+    EXPECT_FALSE(v.owns());
+    EXPECT_EQ(6, arr[0]);
+    EXPECT_EQ(8, arr[1]);
+}
+
+TEST(TDynamicVector, cant_assign_vector_of_other_size_to_adopted_memory) {
+    int arr[2] = { 0, 0 };
+    TDynamicVector<int> v(arr, 2, adopt), a(3);
+
+    ASSERT_ANY_THROW(v = a);
+    ASSERT_ANY_THROW(v = a + a);
+    EXPECT_FALSE(v.owns());
+}
+
+TEST(TDynamicVector, copy_of_adopted_vector_has_its_own_memory) {
+    int arr[2] = { 1, 2 };
+    TDynamicVector<int> v(arr, 2, adopt);
+
+    TDynamicVector<int> copy(v);
+    copy[0] = 100;
+
+    EXPECT_TRUE(copy.owns());
+    EXPECT_EQ(1, arr[0]);
+}
+
+TEST(TDynamicVector, copy_on_write_copy_shares_buffer) {
+    TDynamicVector<int> v(3);
+    v.setCopyOnWrite(true);
+    v[0] = 5;
+
+    TDynamicVector<int> copy(v);
+
+    const TDynamicVector<int>& cv = v;
+    const TDynamicVector<int>& ccopy = copy;
+    EXPECT_EQ(cv.data(), ccopy.data());
+    EXPECT_TRUE(v.isShared());
+    EXPECT_TRUE(copy.copyOnWrite());
+}
+
+TEST(TDynamicVector, write_to_copy_on_write_copy_detaches_it) {
+    TDynamicVector<int> v(3);
+    v.setCopyOnWrite(true);
+    v[0] = 5;
+    TDynamicVector<int> copy(v);
+
+    copy[0] = 9;
+
+    EXPECT_EQ(5, v[0]);
+    EXPECT_EQ(9, copy[0]);
+    EXPECT_FALSE(v.isShared());
+    EXPECT_FALSE(copy.isShared());
+}
+
+TEST(TDynamicVector, assignment_from_copy_on_write_vector_shares_buffer) {
+    TDynamicVector<int> v(3), w(5);
+    v.setCopyOnWrite(true);
+    w.setCopyOnWrite(true);
+
+    w = v;
+
+    EXPECT_EQ(3, w.size());
+    EXPECT_TRUE(w.isShared());
+    v = TDynamicVector<int>(2);
+    EXPECT_FALSE(w.isShared());
+}
+
+TEST(TDynamicVector, assignment_to_plain_vector_copies_copy_on_write_source) {
+    TDynamicVector<int> v(3), w(3);
+    v.setCopyOnWrite(true);
+    int& ref = w[0];
+
+    w = v;
+    ref = 9;
+
+    EXPECT_FALSE(w.copyOnWrite());
+    EXPECT_FALSE(v.isShared());
+    EXPECT_EQ(9, w[0]);
+    EXPECT_EQ(0, v[0]);
+}
+
+TEST(TDynamicVector, cant_enable_copy_on_write_for_adopted_memory) {
+    int arr[2] = { 1, 2 };
+    TDynamicVector<int> v(arr, 2, adopt);
+
+    ASSERT_ANY_THROW(v.setCopyOnWrite(true));
+}
+
+TEST(TDynamicVector, can_read_numbers_separated_by_any_whitespace) {
+    std::istringstream in("  1\t-2\n+3\r\n 40000 ");
+    TDynamicVector<int> v(4);
+
+    in >> v;
+
+    EXPECT_FALSE(in.fail());
+    EXPECT_EQ(1, v[0]);
+    EXPECT_EQ(-2, v[1]);
+    EXPECT_EQ(3, v[2]);
+    EXPECT_EQ(40000, v[3]);
+}
+
+TEST(TDynamicVector, read_leaves_rest_of_stream_unconsumed) {
+    std::istringstream in("1.5 -2e3 0.25 tail");
+    TDynamicVector<double> v(3);
+    std::string rest;
+
+    in >> v >> rest;
+
+    EXPECT_EQ(1.5, v[0]);
+    EXPECT_EQ(-2000.0, v[1]);
+    EXPECT_EQ(0.25, v[2]);
+    EXPECT_EQ("tail", rest);
+}
+
+TEST(TDynamicVector, read_sets_failbit_on_malformed_number) {
+    std::istringstream in("1 2x 3");
+    TDynamicVector<int> v(3);
+
+    in >> v;
+
+    EXPECT_TRUE(in.fail());
+    EXPECT_EQ(1, v[0]);
+}
+
+TEST(TDynamicVector, read_sets_failbit_when_stream_ends_early) {
+    std::istringstream in("1 2");
+    TDynamicVector<int> v(3);
+
+    in >> v;
+
+    EXPECT_TRUE(in.fail());
+    EXPECT_TRUE(in.eof());
+}
+
+TEST(TDynamicVector, can_read_number_longer_than_token_buffer) {
+    std::string token = "1." + std::string(100, '0') + "1";
+    std::istringstream in(token + " 2");
+    TDynamicVector<double> v(2);
+
+    in >> v;
+
+    EXPECT_FALSE(in.fail());
+    EXPECT_DOUBLE_EQ(1.0, v[0]);
+    EXPECT_EQ(2.0, v[1]);
+}